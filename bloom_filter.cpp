@@ -0,0 +1,71 @@
+#include "bloom_filter.h"
+
+namespace {
+
+// Spreads keys whose hashes share low bits (keys of one cache shard do)
+uint64_t remix(uint64_t hash) {
+    return hash * 0xC2B2AE3D27D4EB4FULL;
+}
+
+}  // namespace
+
+CountingBloomFilter::CountingBloomFilter(size_t expected_keys) : block_bits(1) {
+    size_t counters_per_block = WORDS_PER_BLOCK * COUNTERS_PER_WORD;
+    size_t wanted = (expected_keys * CACHE_FILTER_COUNTERS_PER_ENTRY + counters_per_block - 1) / counters_per_block;
+    while ((size_t(1) << block_bits) < wanted) {
+        block_bits++;
+    }
+    blocks.reset(new Block[size_t(1) << block_bits]);
+    clear();
+}
+
+bool CountingBloomFilter::may_contain(uint64_t hash) const {
+    uint64_t mixed = remix(hash);
+    const Block& block = blocks[block_for(mixed)];
+    for (int i = 0; i < CACHE_FILTER_HASHES; ++i) {
+        int counter = counter_for(mixed, i);
+        uint64_t word = block.words[counter / COUNTERS_PER_WORD].load(std::memory_order_relaxed);
+        if (((word >> (counter % COUNTERS_PER_WORD * 4)) & 0xF) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CountingBloomFilter::add(uint64_t hash) {
+    uint64_t mixed = remix(hash);
+    Block& block = blocks[block_for(mixed)];
+    for (int i = 0; i < CACHE_FILTER_HASHES; ++i) {
+        int counter = counter_for(mixed, i);
+        std::atomic<uint64_t>& word = block.words[counter / COUNTERS_PER_WORD];
+        int shift = counter % COUNTERS_PER_WORD * 4;
+        // The only writer, so a plain load and store cannot lose an update
+        uint64_t value = word.load(std::memory_order_relaxed);
+        if (((value >> shift) & 0xF) != 0xF) {
+            word.store(value + (uint64_t(1) << shift), std::memory_order_relaxed);
+        }
+    }
+}
+
+void CountingBloomFilter::remove(uint64_t hash) {
+    uint64_t mixed = remix(hash);
+    Block& block = blocks[block_for(mixed)];
+    for (int i = 0; i < CACHE_FILTER_HASHES; ++i) {
+        int counter = counter_for(mixed, i);
+        std::atomic<uint64_t>& word = block.words[counter / COUNTERS_PER_WORD];
+        int shift = counter % COUNTERS_PER_WORD * 4;
+        uint64_t value = word.load(std::memory_order_relaxed);
+        // A saturated counter has lost count of its keys; leave it set
+        if (((value >> shift) & 0xF) != 0xF) {
+            word.store(value - (uint64_t(1) << shift), std::memory_order_relaxed);
+        }
+    }
+}
+
+void CountingBloomFilter::clear() {
+    for (size_t i = 0; i < (size_t(1) << block_bits); ++i) {
+        for (int w = 0; w < WORDS_PER_BLOCK; ++w) {
+            blocks[i].words[w].store(0, std::memory_order_relaxed);
+        }
+    }
+}
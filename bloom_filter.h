@@ -0,0 +1,54 @@
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include "common.h"
+#include <atomic>
+#include <memory>
+
+/**
+ * Counting blocked Bloom filter over 64-bit key hashes
+ * Each key maps to one 64-byte block and sets CACHE_FILTER_HASHES 4-bit
+ * counters inside it, so a query reads a single cache line. Counters make
+ * removal possible; one that saturates at 15 is never decremented again,
+ * which can only cost false positives. A false "absent" is impossible.
+ * Queries take no lock; add, remove and clear must be serialised by the owner.
+ */
+class CountingBloomFilter {
+private:
+    static constexpr int WORDS_PER_BLOCK = 8;
+    static constexpr int COUNTERS_PER_WORD = 16;
+
+    struct alignas(64) Block {
+        std::atomic<uint64_t> words[WORDS_PER_BLOCK];
+    };
+
+    std::unique_ptr<Block[]> blocks;
+    int block_bits;
+
+    // Private helper methods
+    size_t block_for(uint64_t mixed) const { return static_cast<size_t>(mixed >> (64 - block_bits)); }
+    static int counter_for(uint64_t mixed, int hash) {
+        // 7 bits each, clear of the bits that picked the block
+        return static_cast<int>((mixed >> (8 + 7 * hash)) & (WORDS_PER_BLOCK * COUNTERS_PER_WORD - 1));
+    }
+
+public:
+    // Sized for CACHE_FILTER_COUNTERS_PER_ENTRY counters per expected key
+    explicit CountingBloomFilter(size_t expected_keys);
+
+    // Delete copy constructor and assignment operator
+    CountingBloomFilter(const CountingBloomFilter&) = delete;
+    CountingBloomFilter& operator=(const CountingBloomFilter&) = delete;
+
+    // False only if no key with this hash has been added and not removed
+    bool may_contain(uint64_t hash) const;
+
+    void add(uint64_t hash);
+    // hash must have been added
+    void remove(uint64_t hash);
+    void clear();
+
+    size_t memory_bytes() const { return sizeof(Block) << block_bits; }
+};
+
+#endif
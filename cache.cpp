@@ -1,149 +1,500 @@
 #include "cache.h"
 #include <algorithm>
-#include <sstream>
-#include <iomanip>
+#include <cctype>
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <new>
+#include <thread>
 
-MessageCache::MessageCache(int cap) 
-    : capacity(cap), head(0), tail(0), size(0), hits(0), misses(0) {
+namespace {
+    
+// splitmix64 finaliser: spreads the sender hash and timestamp over all 64 bits
+uint64_t mix64(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ULL;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBULL;
+    value ^= value >> 31;
+    return value;
+}
+    
+// Each size class keeps a partly used slab, so small budgets get small slabs
+size_t slab_size_for(size_t byte_budget) {
+    size_t pages = byte_budget / CACHE_SLABS_PER_BUDGET / 4096;
+    return std::min(CACHE_SLAB_SIZE, std::max<size_t>(1, pages) * 4096);
+}
+    
+// Arena bytes an entry is charged: its node, its sender if too long to be
+// stored inline, and its content
+size_t entry_weight(const SlabArena& arena, size_t sender_size, size_t content_size) {
+    static const size_t inline_sender = ArenaString().capacity();
+    size_t weight = arena.block_size_for(sizeof(CacheNode<MessageId, MessagePayload>)) +
+                    arena.block_size_for(content_size);
+    if (sender_size > inline_sender) {
+        weight += arena.block_size_for(sender_size + 1);
+    }
+    return weight;
+}
+    
+}  // namespace
+
+MessageKey::MessageKey(std::string_view sender_name, time_t ts)
+    : sender(sender_name), timestamp(ts),
+      hash(mix64(std::hash<std::string_view>{}(sender_name) ^ mix64(static_cast<uint64_t>(ts)))) {}
+
+bool MessageKey::parse(const std::string& message_id, MessageKey& key) {
+    // Senders may contain '_', timestamps never do
+    size_t split = message_id.rfind('_');
+    if (split == std::string::npos || split + 1 == message_id.size()) {
+        return false;
+    }
+    
+    const char* digits = message_id.c_str() + split + 1;
+    if (!isdigit(static_cast<unsigned char>(digits[0])) && digits[0] != '-') {
+        return false;
+    }
+    char* end = nullptr;
+    errno = 0;
+    long long ts = strtoll(digits, &end, 10);
+    if (errno != 0 || *end != '\0') {
+        return false;
+    }
+    
+    key = MessageKey(std::string_view(message_id.data(), split), static_cast<time_t>(ts));
+    return true;
+}
+
+MessageId::MessageId(const MessageKey& key, SlabArena* arena)
+    : sender(key.sender.data(), key.sender.size(), ArenaAllocator<char>(arena)), timestamp(key.timestamp) {}
+
+MessagePayload::MessagePayload(std::string_view bytes, std::shared_ptr<const std::string> shared,
+                               SlabArena* slab_arena)
+    : arena(slab_arena) {
+    if (arena) {
+        // The handle holds the block's slab, so it stays readable after eviction
+        char* block = static_cast<char*>(arena->allocate(bytes.size()));
+        memcpy(block, bytes.data(), bytes.size());
+        content = CachedContent(arena->share(block), std::string_view(block, bytes.size()));
+    } else {
+        if (!shared) {
+            shared = std::make_shared<const std::string>(bytes);
+        }
+        std::string_view view = *shared;
+        content = CachedContent(std::move(shared), view);
+    }
+}
+
+MessagePayload::~MessagePayload() {
+    if (arena) {
+        void* block = const_cast<char*>(content.data());
+        size_t bytes = content.size();
+        content = CachedContent();
+        arena->release(block, bytes, true);
+    }
+}
+
+MessageCache::Shard::Shard(int cap, size_t bytes, EvictionPolicyType policy_type)
+    : arena(bytes > 0 ? std::make_unique<SlabArena>(slab_size_for(bytes)) : nullptr),
+      cache(cap, bytes, DynamicEviction(policy_type, cap), ArenaAllocator<MessagePayload>(arena.get())) {}
+
+MessageCache::ExpiryThread::ExpiryThread(std::vector<ShardCache*> targets) : running(true) {
+    thread = std::thread([this, targets]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!wake.wait_for(lock, std::chrono::milliseconds(CACHE_EXPIRY_TICK_MS), [this]() { return !running; })) {
+            lock.unlock();
+            time_t now = time(nullptr);
+            for (ShardCache* shard : targets) {
+                shard->expire(now);
+            }
+            lock.lock();
+        }
+    });
+}
+
+MessageCache::ExpiryThread::~ExpiryThread() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+MessageCache::MessageCache(int cap, EvictionPolicyType policy, int shard_count)
+    : counters(new ThreadCounters[EPOCH_MAX_THREADS]), capacity(cap), byte_budget(0),
+      default_ttl(CACHE_DEFAULT_TTL), negative_filter(false) {
     if (capacity <= 0) {
         throw std::invalid_argument("Cache capacity must be positive");
     }
-    cache.resize(capacity);
+    build_shards(0, policy, shard_count);
+}
+
+MessageCache::MessageCache(CacheByteBudget budget, EvictionPolicyType policy, int shard_count)
+    : counters(new ThreadCounters[EPOCH_MAX_THREADS]), capacity(0), byte_budget(budget.bytes),
+      default_ttl(CACHE_DEFAULT_TTL), negative_filter(false) {
+    // The smallest possible entry bounds how many can fit, which sizes the index
+    size_t smallest = entry_weight(SlabArena(CACHE_SLAB_SIZE), 0, 0);
+    if (byte_budget / smallest == 0) {
+        throw std::invalid_argument("Cache byte budget is too small for one entry");
+    }
+    capacity = static_cast<int>(std::min<size_t>(byte_budget / smallest, INT32_MAX));
+    build_shards(byte_budget, policy, shard_count);
+}
+
+void MessageCache::build_shards(size_t bytes, EvictionPolicyType policy, int shard_count) {
+    if (shard_count < 0) {
+        throw std::invalid_argument("Cache shard count cannot be negative");
+    }
+    if (shard_count == 0) {
+        shard_count = std::min(CACHE_SHARDS, capacity / CACHE_MIN_SHARD_CAPACITY);
+    }
+    // Every shard needs room for at least one entry
+    shard_count = std::max(1, std::min(shard_count, capacity));
+    
+    // Spread the remainder so shard capacities add up to the total
+    size_t shard_bytes = bytes / shard_count;
+    shards.reserve(shard_count);
+    for (int i = 0; i < shard_count; ++i) {
+        int shard_capacity = capacity / shard_count + (i < capacity % shard_count ? 1 : 0);
+        size_t budget = shard_bytes + (i < static_cast<int>(bytes % shard_count) ? 1 : 0);
+        shards.push_back(std::make_unique<Shard>(shard_capacity, budget, policy));
+    }
 }
 
 MessageCache::~MessageCache() {
-    // Cleanup handled by vector destructor
+    // The expiry thread goes first; the shard destructors do the rest
+    stop_expiry();
 }
 
-std::string MessageCache::generate_message_id(const std::string& sender, time_t timestamp) const {
-    std::stringstream ss;
-    ss << sender << "_" << timestamp;
-    return ss.str();
+MessageCache::Shard& MessageCache::shard_for(uint64_t hash) const {
+    return *shards[hash % shards.size()];
 }
 
-int MessageCache::find_lru_index() const {
-    if (size == 0) {
-        return 0;
+void MessageCache::group_by_shard(const MessageKey* keys, size_t count, std::vector<uint32_t>& order,
+                                  std::vector<uint32_t>& starts) const {
+    // Counting sort, stable so each shard sees its keys in batch order
+    starts.assign(shards.size() + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        starts[keys[i].hash % shards.size() + 1]++;
+    }
+    for (size_t i = 1; i < starts.size(); ++i) {
+        starts[i] += starts[i - 1];
     }
+    order.resize(count);
+    std::vector<uint32_t> next(starts.begin(), starts.end() - 1);
+    for (size_t i = 0; i < count; ++i) {
+        order[next[keys[i].hash % shards.size()]++] = static_cast<uint32_t>(i);
+    }
+}
+
+bool MessageCache::insert(const std::string& sender, const std::string& content, time_t timestamp, time_t ttl) {
+    MessageKey key(sender, timestamp);
+    Shard& shard = shard_for(key.hash);
+    return shard.cache.batch([&](ShardCache::Batch& writer) {
+        return insert_entry(writer, shard, key, content, nullptr, ttl);
+    });
+}
+
+bool MessageCache::insert(const std::string& sender, std::shared_ptr<const std::string> content,
+                          time_t timestamp, time_t ttl) {
+    MessageKey key(sender, timestamp);
+    Shard& shard = shard_for(key.hash);
+    std::string_view bytes = *content;
+    return shard.cache.batch([&](ShardCache::Batch& writer) {
+        return insert_entry(writer, shard, key, bytes, std::move(content), ttl);
+    });
+}
+
+bool MessageCache::insert_entry(ShardCache::Batch& writer, Shard& shard, const MessageKey& key,
+                                std::string_view content, std::shared_ptr<const std::string> payload, time_t ttl) {
+    SlabArena* arena = shard.arena.get();
     
-    int lru_index = 0;
-    time_t oldest_access = cache[0].last_access;
+    // Without a budget every entry weighs the same and only the count is bounded
+    size_t weight = arena ? entry_weight(*arena, key.sender.size(), content.size()) : 1;
+    // Blocks a reader's handle keeps from being reused still take memory
+    size_t held = arena ? arena->reclaim_deferred() : 0;
+    time_t lifetime = ttl == USE_DEFAULT_TTL ? default_ttl : ttl;
+    return writer.emplace(key, std::forward_as_tuple(key, arena),
+                          std::forward_as_tuple(content, std::move(payload), arena), weight, lifetime, held);
+}
+
+size_t MessageCache::insert_many(const CacheInsert* messages, size_t count, time_t ttl) {
+    std::vector<MessageKey> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        keys.emplace_back(messages[i].sender, messages[i].timestamp);
+    }
+    std::vector<uint32_t> order, starts;
+    group_by_shard(keys.data(), count, order, starts);
     
-    for (int i = 1; i < size; ++i) {
-        if (cache[i].valid && cache[i].last_access < oldest_access) {
-            oldest_access = cache[i].last_access;
-            lru_index = i;
+    size_t inserted = 0;
+    for (size_t s = 0; s < shards.size(); ++s) {
+        if (starts[s] == starts[s + 1]) {
+            continue;
         }
+        Shard& shard = *shards[s];
+        for (uint32_t i = starts[s]; i < starts[s + 1]; ++i) {
+            shard.cache.prefetch(keys[order[i]]);
+        }
+        inserted += shard.cache.batch([&](ShardCache::Batch& writer) {
+            size_t added = 0;
+            for (uint32_t i = starts[s]; i < starts[s + 1]; ++i) {
+                const CacheInsert& message = messages[order[i]];
+                std::string_view bytes = *message.content;
+                added += insert_entry(writer, shard, keys[order[i]], bytes, message.content, ttl) ? 1 : 0;
+            }
+            return added;
+        });
     }
-    
-    return lru_index;
+    return inserted;
 }
 
-bool MessageCache::insert(const std::string& sender, const std::string& content, time_t timestamp) {
-    std::unique_lock<std::shared_mutex> lock(cache_mutex);
+CachedContent MessageCache::lookup(const MessageKey& key) const {
+    const Shard& shard = shard_for(key.hash);
+    ThreadCounters& counter = counters[Epoch::thread_index()];
     
-    std::string msg_id = generate_message_id(sender, timestamp);
-    
-    // Check if already exists
-    if (index_map.find(msg_id) != index_map.end()) {
-        return false;
+    CachedContent content;
+    VisitResult result =
+        shard.cache.try_visit(key, [&content](const MessagePayload& payload) { content = payload.content; });
+    if (result == VisitResult::HIT) {
+        counter.hits.fetch_add(1, std::memory_order_relaxed);
+        return content;
     }
     
-    int insert_index;
+    counter.misses.fetch_add(1, std::memory_order_relaxed);
+    if (result == VisitResult::FILTERED) {
+        counter.filtered.fetch_add(1, std::memory_order_relaxed);
+    } else if (negative_filter) {
+        counter.false_positives.fetch_add(1, std::memory_order_relaxed);
+    }
+    return CachedContent();
+}
+
+void MessageCache::update_access(const MessageKey& key) {
+    shard_for(key.hash).cache.update_access(key);
+}
+
+size_t MessageCache::lookup_many(const MessageKey* keys, size_t count, CachedContent* results) const {
+    // Lookups take no lock, so there is nothing to group; start every
+    // key's cache miss before waiting on the first
+    for (size_t i = 0; i < count; ++i) {
+        shard_for(keys[i].hash).cache.prefetch(keys[i]);
+    }
     
-    if (size < capacity) {
-        // Cache not full, use next available slot
-        insert_index = size;
-        size++;
-    } else {
-        // Cache full, evict LRU entry
-        insert_index = find_lru_index();
-        
-        // Remove old entry from index map
-        if (cache[insert_index].valid) {
-            index_map.erase(cache[insert_index].message_id);
+    // One guard for the batch; the per-lookup guards nest inside it for free
+    Epoch::Guard guard;
+    size_t hits = 0;
+    size_t filtered = 0;
+    for (size_t i = 0; i < count; ++i) {
+        CachedContent& result = results[i];
+        result = CachedContent();
+        const ShardCache& cache = shard_for(keys[i].hash).cache;
+        VisitResult found =
+            cache.try_visit(keys[i], [&result](const MessagePayload& payload) { result = payload.content; });
+        if (found == VisitResult::HIT) {
+            hits++;
+        } else if (found == VisitResult::FILTERED) {
+            filtered++;
         }
     }
     
-    // Insert new entry
-    cache[insert_index].message_id = msg_id;
-    cache[insert_index].content = content;
-    cache[insert_index].sender = sender;
-    cache[insert_index].timestamp = timestamp;
-    cache[insert_index].last_access = time(nullptr);
-    cache[insert_index].access_count = 1;
-    cache[insert_index].valid = true;
-    
-    index_map[msg_id] = insert_index;
+    ThreadCounters& counter = counters[Epoch::thread_index()];
+    counter.hits.fetch_add(hits, std::memory_order_relaxed);
+    counter.misses.fetch_add(count - hits, std::memory_order_relaxed);
+    if (negative_filter) {
+        counter.filtered.fetch_add(filtered, std::memory_order_relaxed);
+        counter.false_positives.fetch_add(count - hits - filtered, std::memory_order_relaxed);
+    }
+    return hits;
+}
+
+size_t MessageCache::touch_many(const MessageKey* keys, size_t count) {
+    std::vector<uint32_t> order, starts;
+    group_by_shard(keys, count, order, starts);
     
-    return true;
+    size_t touched = 0;
+    for (size_t s = 0; s < shards.size(); ++s) {
+        if (starts[s] == starts[s + 1]) {
+            continue;
+        }
+        ShardCache& cache = shards[s]->cache;
+        for (uint32_t i = starts[s]; i < starts[s + 1]; ++i) {
+            cache.prefetch(keys[order[i]]);
+        }
+        touched += cache.batch([&](ShardCache::Batch& writer) {
+            size_t found = 0;
+            for (uint32_t i = starts[s]; i < starts[s + 1]; ++i) {
+                found += writer.update_access(keys[order[i]]) ? 1 : 0;
+            }
+            return found;
+        });
+    }
+    return touched;
+}
+
+CachedContent MessageCache::lookup(const std::string& message_id) const {
+    MessageKey key("", 0);
+    if (!MessageKey::parse(message_id, key)) {
+        // No message can have this ID
+        counters[Epoch::thread_index()].misses.fetch_add(1, std::memory_order_relaxed);
+        return CachedContent();
+    }
+    return lookup(key);
 }
 
 bool MessageCache::lookup(const std::string& message_id, std::string& content) const {
-    std::shared_lock<std::shared_mutex> lock(cache_mutex);
-    
-    auto it = index_map.find(message_id);
-    if (it != index_map.end()) {
-        int index = it->second;
-        if (index >= 0 && index < size && cache[index].valid) {
-            content = cache[index].content;
-            const_cast<MessageCache*>(this)->hits++;
-            return true;
-        }
+    CachedContent cached = lookup(message_id);
+    if (!cached) {
+        return false;
     }
-    
-    const_cast<MessageCache*>(this)->misses++;
-    return false;
+    content.assign(cached.data(), cached.size());
+    return true;
 }
 
 void MessageCache::update_access(const std::string& message_id) {
-    std::unique_lock<std::shared_mutex> lock(cache_mutex);
-    
-    auto it = index_map.find(message_id);
-    if (it != index_map.end()) {
-        int index = it->second;
-        if (index >= 0 && index < size && cache[index].valid) {
-            cache[index].last_access = time(nullptr);
-            cache[index].access_count++;
-        }
+    MessageKey key("", 0);
+    if (MessageKey::parse(message_id, key)) {
+        update_access(key);
+    }
+}
+
+void MessageCache::set_default_ttl(time_t seconds) {
+    if (seconds < 0) {
+        throw std::invalid_argument("Cache TTL cannot be negative");
+    }
+    default_ttl = seconds;
+}
+
+void MessageCache::enable_negative_filter() {
+    for (auto& shard : shards) {
+        shard->cache.enable_negative_filter();
+    }
+    negative_filter = true;
+}
+
+size_t MessageCache::expire(time_t now) {
+    size_t total = 0;
+    for (auto& shard : shards) {
+        total += shard->cache.expire(now);
+    }
+    return total;
+}
+
+void MessageCache::start_expiry() {
+    if (expiry) {
+        return;
     }
+    
+    // Shards live on the heap, so the thread's pointers survive a move of the cache
+    std::vector<ShardCache*> targets;
+    for (auto& shard : shards) {
+        targets.push_back(&shard->cache);
+    }
+    expiry = std::make_unique<ExpiryThread>(std::move(targets));
+}
+
+void MessageCache::stop_expiry() {
+    expiry.reset();
 }
 
 uint64_t MessageCache::get_hits() const {
-    std::shared_lock<std::shared_mutex> lock(cache_mutex);
-    return hits;
+    uint64_t total = 0;
+    for (size_t i = 0; i < EPOCH_MAX_THREADS; ++i) {
+        total += counters[i].hits.load(std::memory_order_relaxed);
+    }
+    return total;
 }
 
 uint64_t MessageCache::get_misses() const {
-    std::shared_lock<std::shared_mutex> lock(cache_mutex);
-    return misses;
+    uint64_t total = 0;
+    for (size_t i = 0; i < EPOCH_MAX_THREADS; ++i) {
+        total += counters[i].misses.load(std::memory_order_relaxed);
+    }
+    return total;
 }
 
 double MessageCache::get_hit_rate() const {
-    std::shared_lock<std::shared_mutex> lock(cache_mutex);
-    uint64_t total = hits + misses;
+    uint64_t hits = get_hits();
+    uint64_t total = hits + get_misses();
     if (total == 0) return 0.0;
     return (static_cast<double>(hits) / total) * 100.0;
 }
 
+uint64_t MessageCache::get_filtered() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < EPOCH_MAX_THREADS; ++i) {
+        total += counters[i].filtered.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+double MessageCache::get_filter_false_positive_rate() const {
+    uint64_t false_positives = 0;
+    for (size_t i = 0; i < EPOCH_MAX_THREADS; ++i) {
+        false_positives += counters[i].false_positives.load(std::memory_order_relaxed);
+    }
+    uint64_t absent = false_positives + get_filtered();
+    if (absent == 0) return 0.0;
+    return (static_cast<double>(false_positives) / absent) * 100.0;
+}
+
+size_t MessageCache::get_filter_bytes() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard->cache.get_filter_bytes();
+    }
+    return total;
+}
+
 int MessageCache::get_size() const {
-    std::shared_lock<std::shared_mutex> lock(cache_mutex);
-    return size;
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard->cache.get_size();
+    }
+    return static_cast<int>(total);
+}
+
+CacheMemoryStats MessageCache::get_memory_stats() const {
+    CacheMemoryStats total = {byte_budget, 0, 0, 0, 0, 0, 0, 0};
+    for (const auto& shard : shards) {
+        if (!shard->arena) {
+            continue;
+        }
+        // The arena is only touched under the shard's lock
+        shard->cache.with_lock([&total, &shard]() {
+            ArenaStats arena = shard->arena->stats();
+            total.block_bytes += arena.block_bytes;
+            total.requested_bytes += arena.requested_bytes;
+            total.reserved_bytes += arena.reserved_bytes;
+            total.slabs += arena.slabs;
+            total.deferred_blocks += arena.deferred_blocks;
+            total.deferred_bytes += arena.deferred_bytes;
+        });
+        total.used_bytes += shard->cache.get_weight();
+    }
+    return total;
+}
+
+uint64_t MessageCache::get_expired() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard->cache.get_expired();
+    }
+    return total;
 }
 
 void MessageCache::clear() {
-    std::unique_lock<std::shared_mutex> lock(cache_mutex);
-    
-    for (int i = 0; i < size; ++i) {
-        cache[i].valid = false;
-        cache[i].message_id.clear();
-        cache[i].content.clear();
-        cache[i].sender.clear();
+    for (auto& shard : shards) {
+        shard->cache.clear();
     }
     
-    index_map.clear();
-    size = 0;
-    hits = 0;
-    misses = 0;
-}
+    for (size_t i = 0; i < EPOCH_MAX_THREADS; ++i) {
+        counters[i].hits.store(0, std::memory_order_relaxed);
+        counters[i].misses.store(0, std::memory_order_relaxed);
+        counters[i].filtered.store(0, std::memory_order_relaxed);
+        counters[i].false_positives.store(0, std::memory_order_relaxed);
+    }
+}
\ No newline at end of file
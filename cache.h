@@ -1,31 +1,207 @@
 #ifndef CACHE_H
 #define CACHE_H
 #include "common.h"
+#include "epoch.h"
+#include "eviction_policy.h"
+#include "generic_cache.h"
+#include "slab_arena.h"
 #include <vector>
 #include <mutex>
-#include <shared_mutex>
-#include <unordered_map>
+#include <condition_variable>
+#include <thread>
 #include <string>
+#include <string_view>
+#include <memory>
+#include <atomic>
 
+// Identifies a cached message without building a string ID. The 64-bit
+// hash picks the shard and index slot; sender and timestamp are compared in
+// full, so a hash collision can never return another message. The sender
+// must outlive the key.
+struct MessageKey {
+    std::string_view sender;
+    time_t timestamp;
+    uint64_t hash;
+    
+    MessageKey(std::string_view sender, time_t timestamp);
+    
+    // Parse a legacy "sender_timestamp" ID; false if it is malformed
+    static bool parse(const std::string& message_id, MessageKey& key);
+};
+
+// Cached message bytes together with whatever keeps them alive (the shared
+// broadcast payload or the arena slab); stays valid after eviction
+class CachedContent {
+private:
+    std::shared_ptr<const void> owner;
+    std::string_view bytes;
+    
+public:
+    CachedContent() = default;
+    CachedContent(std::shared_ptr<const void> keep_alive, std::string_view content)
+        : owner(std::move(keep_alive)), bytes(content) {}
+    
+    // False on a miss
+    explicit operator bool() const { return owner != nullptr; }
+    
+    std::string_view view() const { return bytes; }
+    const char* data() const { return bytes.data(); }
+    size_t size() const { return bytes.size(); }
+    std::string str() const { return std::string(bytes); }
+};
+
+// One message for MessageCache::insert_many; the sender must outlive the call
+struct CacheInsert {
+    std::string_view sender;
+    std::shared_ptr<const std::string> content;
+    time_t timestamp;
+};
+
+// Selects the byte-budget constructor
+struct CacheByteBudget {
+    size_t bytes;
+};
+
+// Memory use of a byte-budget cache (all zero when capacity counts entries)
+struct CacheMemoryStats {
+    size_t budget_bytes;
+    size_t used_bytes;       // Blocks of cached entries, charged against the budget
+    size_t block_bytes;      // Allocated blocks, including evicted entries readers may hold
+    size_t requested_bytes;  // Entry headers, senders and contents before rounding
+    size_t reserved_bytes;   // Slab memory held
+    size_t slabs;
+    size_t deferred_blocks;
+    size_t deferred_bytes;   // Freed blocks a handle keeps from reuse, also charged
+    
+    // Lost to size-class rounding / to free blocks inside slabs
+    double internal_fragmentation() const {
+        return block_bytes ? 1.0 - static_cast<double>(requested_bytes) / block_bytes : 0.0;
+    }
+    double external_fragmentation() const {
+        return reserved_bytes ? 1.0 - static_cast<double>(block_bytes) / reserved_bytes : 0.0;
+    }
+};
+
+// Sender name stored in the shard's arena (or on the heap without one)
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+// Key of a cached message
+struct MessageId {
+    ArenaString sender;
+    time_t timestamp;
+    
+    MessageId(const MessageKey& key, SlabArena* arena);
+};
+
+// The MessageKey hash, already computed
+struct MessageKeyHash {
+    uint64_t operator()(const MessageKey& key) const { return key.hash; }
+};
+
+struct MessageKeyEqual {
+    bool operator()(const MessageId& id, const MessageKey& key) const {
+        return id.timestamp == key.timestamp && std::string_view(id.sender.data(), id.sender.size()) == key.sender;
+    }
+};
+
+// Cached message bytes: a block of the shard's arena, or the shared
+// broadcast payload (or a copy) without one
+class MessagePayload {
+private:
+    SlabArena* arena;
+    
+public:
+    CachedContent content;
+    
+    MessagePayload(std::string_view bytes, std::shared_ptr<const std::string> shared, SlabArena* slab_arena);
+    ~MessagePayload();
+    
+    // Delete copy constructor and assignment operator
+    MessagePayload(const MessagePayload&) = delete;
+    MessagePayload& operator=(const MessagePayload&) = delete;
+};
+
+/**
+ * Message cache with pluggable eviction (LRU by default)
+ * Keys are hashed to one of several independent shards, each with its own
+ * writer lock and eviction policy instance, so workers touching different
+ * messages do not serialise on one mutex. Eviction decisions are made per
+ * shard; caches too small to split keep a single shard and exact order.
+ *
+ * Each shard is a Cache<> (see generic_cache.h): lookups take no lock and
+ * return the content as a refcounted handle, and evicted entries are freed
+ * once no reader can hold them.
+ *
+ * Constructed with a CacheByteBudget, capacity is a memory budget instead:
+ * each entry, its sender and its content are blocks of a per-shard slab
+ * arena, and the policy evicts until the new entry's blocks fit.
+ *
+ * Entries inserted with a TTL (or under a default TTL) sit in the shard's
+ * timer wheel. expire() - called every second by the expiry thread once
+ * start_expiry() runs - drops those whose time is up; lookups never check.
+ *
+ * With the negative filter enabled, a lookup of an absent message usually
+ * ends at the shard's Bloom filter without probing the index.
+ */
 class MessageCache {
 private:
-    std::vector<CacheEntry> cache;
-    int capacity;
-    int head;
-    int tail;  // Not currently used but kept for future circular buffer implementation
-    int size;
-    std::unordered_map<std::string, int> index_map; 
-    mutable std::shared_mutex cache_mutex;
+    using ShardCache = Cache<MessageId, MessagePayload, MessageKeyHash, MessageKeyEqual, DynamicEviction,
+                             std::mutex, ArenaAllocator<MessagePayload>>;
+    
+    struct alignas(64) Shard {
+        // Declared before cache, whose entries are freed into it
+        std::unique_ptr<SlabArena> arena;  // Null unless the cache has a byte budget
+        ShardCache cache;
+        
+        Shard(int cap, size_t bytes, EvictionPolicyType policy_type);
+    };
     
-    uint64_t hits;
-    uint64_t misses;
+    // Advances every shard's timer wheel once per CACHE_EXPIRY_TICK_MS
+    struct ExpiryThread {
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool running;
+        std::thread thread;
+        
+        explicit ExpiryThread(std::vector<ShardCache*> targets);
+        ~ExpiryThread();
+    };
+    
+    // Per-thread hit/miss counts, so lookups only write their own cache line
+    struct alignas(64) ThreadCounters {
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> misses;
+        std::atomic<uint64_t> filtered;         // Misses the negative filter answered
+        std::atomic<uint64_t> false_positives;  // Misses the filter let through to the index
+        
+        ThreadCounters() : hits(0), misses(0), filtered(0), false_positives(0) {}
+    };
+    
+    // First, so a move assignment stops the old thread before replacing the shards
+    std::unique_ptr<ExpiryThread> expiry;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::unique_ptr<ThreadCounters[]> counters;  // Indexed by Epoch::thread_index()
+    int capacity;
+    size_t byte_budget;
+    time_t default_ttl;
+    bool negative_filter;
     
     // Private helper methods
-    int find_lru_index() const;
-    std::string generate_message_id(const std::string& sender, time_t timestamp) const;
-
+    void build_shards(size_t bytes, EvictionPolicyType policy, int shard_count);
+    Shard& shard_for(uint64_t hash) const;
+    // Batch positions ordered by shard; shard i's run is order[starts[i]..starts[i + 1])
+    void group_by_shard(const MessageKey* keys, size_t count, std::vector<uint32_t>& order,
+                        std::vector<uint32_t>& starts) const;
+    bool insert_entry(ShardCache::Batch& writer, Shard& shard, const MessageKey& key, std::string_view content,
+                      std::shared_ptr<const std::string> payload, time_t ttl);
+    
 public:
-    explicit MessageCache(int capacity = CACHE_SIZE);
+    // shard_count 0 picks one from the capacity (see CACHE_SHARDS)
+    explicit MessageCache(int capacity = CACHE_SIZE, EvictionPolicyType policy = EvictionPolicyType::LRU,
+                          int shard_count = 0);
+    // Capacity is a memory budget for entries, senders and contents
+    explicit MessageCache(CacheByteBudget budget, EvictionPolicyType policy = EvictionPolicyType::LRU,
+                          int shard_count = 0);
     ~MessageCache();
     
     // Delete copy constructor and assignment operator
@@ -36,16 +212,61 @@ public:
     MessageCache(MessageCache&&) noexcept = default;
     MessageCache& operator=(MessageCache&&) noexcept = default;
     
-    bool insert(const std::string& sender, const std::string& content, time_t timestamp);
+    // ttl in seconds from now; 0 never expires, USE_DEFAULT_TTL takes the cache's default
+    static constexpr time_t USE_DEFAULT_TTL = -1;
+    
+    bool insert(const std::string& sender, const std::string& content, time_t timestamp,
+                time_t ttl = USE_DEFAULT_TTL);
+    // Keeps a reference to content instead of copying it (unless the cache has a byte budget)
+    bool insert(const std::string& sender, std::shared_ptr<const std::string> content, time_t timestamp,
+                time_t ttl = USE_DEFAULT_TTL);
+    // Returns the cached content without copying it, or an empty handle on a miss
+    CachedContent lookup(const MessageKey& key) const;
+    void update_access(const MessageKey& key);
+    
+    // Batched forms for several keys at once: each touched shard's lock is
+    // taken once, and every key's index slot is prefetched before the first
+    // probe. Return how many keys hit (or were inserted); results[i] is the
+    // content for keys[i], empty on a miss
+    size_t lookup_many(const MessageKey* keys, size_t count, CachedContent* results) const;
+    size_t insert_many(const CacheInsert* messages, size_t count, time_t ttl = USE_DEFAULT_TTL);
+    size_t touch_many(const MessageKey* keys, size_t count);
+    
+    // Compatibility overloads taking "sender_timestamp" string IDs
+    CachedContent lookup(const std::string& message_id) const;
     bool lookup(const std::string& message_id, std::string& content) const;
     void update_access(const std::string& message_id);
     
-    // Const getters
+    // TTL for inserts that do not pass one; set before the cache is shared
+    void set_default_ttl(time_t seconds);
+    time_t get_default_ttl() const { return default_ttl; }
+    
+    // Answer most lookups of absent messages from a per-shard counting Bloom
+    // filter instead of the index; call before the cache is shared
+    void enable_negative_filter();
+    bool has_negative_filter() const { return negative_filter; }
+    
+    // Drop every entry whose TTL ran out by now; returns how many
+    size_t expire(time_t now);
+    // Run expire() in the background until stop_expiry() or destruction
+    void start_expiry();
+    void stop_expiry();
+    
+    // Const getters (summed over shards)
     uint64_t get_hits() const;
     uint64_t get_misses() const;
     double get_hit_rate() const;
     int get_size() const;
+    uint64_t get_expired() const;
     int get_capacity() const { return capacity; }
+    int get_shard_count() const { return static_cast<int>(shards.size()); }
+    const char* get_policy_name() const { return shards[0]->cache.get_policy().name(); }
+    size_t get_byte_budget() const { return byte_budget; }
+    // Share of the lookups for absent messages the filter did not stop, in percent
+    double get_filter_false_positive_rate() const;
+    uint64_t get_filtered() const;
+    size_t get_filter_bytes() const;
+    CacheMemoryStats get_memory_stats() const;
     
     // Clear cache
     void clear();
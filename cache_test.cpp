@@ -6,6 +6,7 @@
 #include <thread>
 #include <chrono>
 #include <atomic>
+#include <random>
 
 void print_separator() {
     std::cout << std::string(70, '=') << std::endl;
@@ -45,6 +46,11 @@ void test_basic_operations() {
         std::cout << "   Content: \"" << content << "\"" << std::endl;
     }
     
+    bool found_by_key = static_cast<bool>(cache.lookup(MessageKey("Alice", time(nullptr))));
+    std::cout << "   Lookup by MessageKey: " << (found_by_key ? "✓ FOUND" : "✗ NOT FOUND") << std::endl;
+    bool malformed = cache.lookup(std::string("Alice_"), content) || cache.lookup(std::string("Alice"), content);
+    std::cout << "   Lookup malformed IDs: " << (malformed ? "✗ FOUND (ERROR)" : "✓ NOT FOUND") << std::endl;
+    
     // Test 2: Duplicate prevention
     std::cout << "\n2. Testing duplicate prevention..." << std::endl;
     bool inserted = cache.insert("Alice", "Hello World", time(nullptr));
@@ -92,6 +98,44 @@ void test_lru_eviction() {
     print_cache_stats(cache);
 }
 
+void test_large_capacity() {
+    print_test_header("Large Capacity Eviction");
+    
+    const int capacity = 200000;
+    MessageCache cache(capacity);
+    std::string content;
+    time_t base_time = time(nullptr);
+    
+    std::cout << "\n1. Inserting " << capacity + capacity / 8 << " messages into a cache of " << capacity
+              << " (" << cache.get_shard_count() << " shards)..." << std::endl;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < capacity / 2; i++) {
+        cache.insert("Bulk" + std::to_string(i), "Bulk message", base_time);
+    }
+    
+    // Touch the first quarter so it survives the second wave; the second wave
+    // evicts about half of the untouched entries, leaving slack for shard skew
+    for (int i = 0; i < capacity / 4; i++) {
+        cache.update_access("Bulk" + std::to_string(i) + "_" + std::to_string(base_time));
+    }
+    for (int i = capacity / 2; i < capacity + capacity / 8; i++) {
+        cache.insert("Bulk" + std::to_string(i), "Bulk message", base_time);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "   Completed in " << elapsed << " ms" << std::endl;
+    
+    std::cout << "\n2. Verifying eviction order..." << std::endl;
+    std::string touched_id = "Bulk0_" + std::to_string(base_time);
+    std::string untouched_id = "Bulk" + std::to_string(capacity / 4) + "_" + std::to_string(base_time);
+    bool touched = cache.lookup(touched_id, content);
+    bool untouched = cache.lookup(untouched_id, content);
+    std::cout << "   Lookup touched entry (should still exist): " << (touched ? "✓ FOUND" : "✗ NOT FOUND (ERROR)") << std::endl;
+    std::cout << "   Lookup untouched entry (should be evicted): " << (untouched ? "✗ FOUND (ERROR)" : "✓ NOT FOUND") << std::endl;
+    
+    print_cache_stats(cache);
+}
+
 void test_cache_performance() {
     print_test_header("Cache Performance Test");
     
@@ -176,6 +220,562 @@ void test_concurrent_access() {
     std::cout << "\n✓ No crashes or deadlocks detected" << std::endl;
 }
 
+void test_sharded_concurrency() {
+    print_test_header("Sharded Concurrency Test");
+    
+    MessageCache cache(4096);
+    const int num_threads = 8;
+    const int ops_per_thread = 20000;
+    time_t base_time = time(nullptr);
+    std::atomic<uint64_t> lookups(0);
+    
+    std::cout << "\nStarting " << num_threads << " threads on " << cache.get_shard_count()
+              << " shards (insert, lookup, update_access)..." << std::endl;
+    
+    auto worker = [&](int thread_id) {
+        std::string content;
+        for (int i = 0; i < ops_per_thread; i++) {
+            std::string sender = "T" + std::to_string(thread_id);
+            cache.insert(sender, "Sharded message", base_time + i);
+            
+            // Read back a recent message of a neighbouring thread
+            std::string msg_id = "T" + std::to_string((thread_id + 1) % num_threads) + "_" +
+                                 std::to_string(base_time + i / 2);
+            if (cache.lookup(msg_id, content)) {
+                cache.update_access(msg_id);
+            }
+            lookups++;
+        }
+    };
+    
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back(worker, t);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    
+    std::cout << "\n[Results]" << std::endl;
+    std::cout << "  Completed in " << elapsed << " ms" << std::endl;
+    bool counted = cache.get_hits() + cache.get_misses() == lookups.load();
+    bool bounded = cache.get_size() <= cache.get_capacity();
+    std::cout << "  Hits + misses equal lookups: " << (counted ? "✓ PASS" : "✗ FAIL") << std::endl;
+    std::cout << "  Size within capacity: " << (bounded ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    print_cache_stats(cache);
+}
+
+void test_optimistic_reads() {
+    print_test_header("Lock-Free Lookup Test");
+    
+    MessageCache cache(1024);
+    const int num_readers = 6;
+    const int inserts = 100000;
+    time_t base_time = time(nullptr);
+    std::atomic<bool> done(false);
+    std::atomic<int> wrong_content(0);
+    std::atomic<uint64_t> reads(0);
+    
+    std::cout << "\n1. Holding a handle across eviction..." << std::endl;
+    cache.insert("Holder", "Held message", base_time);
+    CachedContent held = cache.lookup("Holder_" + std::to_string(base_time));
+    for (int i = 0; i < 2048; i++) {
+        cache.insert("Filler", "Filler message", base_time + 1 + i);
+    }
+    bool evicted = !cache.lookup("Holder_" + std::to_string(base_time));
+    bool intact = held && held.view() == "Held message";
+    std::cout << "   Entry evicted: " << (evicted ? "✓ YES" : "✗ NO (ERROR)") << std::endl;
+    std::cout << "   Handle still valid: " << (intact ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n2. " << num_readers << " readers against 1 writer churning " << inserts
+              << " inserts..." << std::endl;
+    
+    // Every message's content is its own id, so readers can check each hit
+    auto reader = [&](int reader_id) {
+        uint64_t local_reads = 0;
+        while (!done.load()) {
+            for (int i = 0; i < 1000; i++) {
+                std::string msg_id = "W_" + std::to_string(base_time + (i * 7 + reader_id) % inserts);
+                CachedContent content = cache.lookup(msg_id);
+                if (content && content.view() != msg_id) {
+                    wrong_content++;
+                }
+                local_reads++;
+            }
+        }
+        reads += local_reads;
+    };
+    
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_readers; t++) {
+        threads.emplace_back(reader, t);
+    }
+    for (int i = 0; i < inserts; i++) {
+        std::string msg_id = "W_" + std::to_string(base_time + i);
+        cache.insert("W", msg_id, base_time + i);
+    }
+    done = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+    
+    std::cout << "\n[Results]" << std::endl;
+    std::cout << "  Lookups performed: " << reads.load() << std::endl;
+    std::cout << "  Hits with wrong content: " << wrong_content.load()
+              << (wrong_content.load() == 0 ? " ✓ PASS" : " ✗ FAIL") << std::endl;
+    
+    print_cache_stats(cache);
+}
+
+void test_eviction_policies() {
+    print_test_header("Eviction Policy Comparison");
+    
+    // Skewed re-reads of chat history interleaved with bursts of one-off
+    // join/leave notices, replayed identically against every policy
+    const int capacity = 512;
+    const int history_size = 400;
+    const int rounds = 200;
+    time_t base_time = time(nullptr);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    
+    std::vector<MessageKey> trace;
+    int notice = 0;
+    for (int round = 0; round < rounds; round++) {
+        for (int i = 0; i < 500; i++) {
+            double u = uniform(rng);
+            trace.emplace_back("History", base_time + static_cast<time_t>(u * u * history_size));
+        }
+        for (int i = 0; i < 300; i++) {
+            trace.emplace_back("Notice", base_time + history_size + notice++);
+        }
+    }
+    
+    std::cout << "\nReplaying " << trace.size() << " requests (cache of " << capacity << ")..." << std::endl;
+    
+    const EvictionPolicyType policies[] = {EvictionPolicyType::LRU, EvictionPolicyType::CLOCK,
+                                           EvictionPolicyType::ARC, EvictionPolicyType::TINY_LFU};
+    double lru_rate = 0.0;
+    double tinylfu_rate = 0.0;
+    
+    for (EvictionPolicyType policy : policies) {
+        MessageCache cache(capacity, policy);
+        for (const MessageKey& key : trace) {
+            if (cache.lookup(key)) {
+                cache.update_access(key);
+            } else {
+                cache.insert(std::string(key.sender), "Trace message", key.timestamp);
+            }
+        }
+        std::cout << "   " << std::left << std::setw(10) << cache.get_policy_name() << std::right
+                  << " hit rate: " << std::fixed << std::setprecision(2) << cache.get_hit_rate() << "%" << std::endl;
+        
+        if (policy == EvictionPolicyType::LRU) {
+            lru_rate = cache.get_hit_rate();
+        } else if (policy == EvictionPolicyType::TINY_LFU) {
+            tinylfu_rate = cache.get_hit_rate();
+        }
+    }
+    
+    std::cout << "\n   W-TinyLFU keeps history through bursts: "
+              << (tinylfu_rate > lru_rate ? "✓ PASS" : "✗ FAIL") << std::endl;
+}
+
+void test_byte_budget() {
+    print_test_header("Byte-Budget Arena Mode");
+    
+    const size_t budget = 4 * 1024 * 1024;
+    MessageCache cache(CacheByteBudget{budget});
+    time_t base_time = time(nullptr);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> small_size(2, 256);
+    std::uniform_int_distribution<int> large_size(257, 4096);
+    
+    std::cout << "\n1. Inserting 50000 messages of 2 B - 4 KB into a " << budget / 1024
+              << " KB budget (" << cache.get_shard_count() << " shards)..." << std::endl;
+    bool within_budget = true;
+    for (int i = 0; i < 50000; i++) {
+        // Mostly short chat lines, some pasted blocks
+        int length = (i % 10 == 0) ? large_size(rng) : small_size(rng);
+        std::string message(length, static_cast<char>('a' + i % 26));
+        cache.insert("Sender" + std::to_string(i % 97), message, base_time + i);
+        if (i % 1000 == 0 && cache.get_memory_stats().used_bytes > budget) {
+            within_budget = false;
+        }
+    }
+    CacheMemoryStats memory = cache.get_memory_stats();
+    std::cout << "   Entries cached: " << cache.get_size() << std::endl;
+    std::cout << "   Bytes used: " << memory.used_bytes << "/" << memory.budget_bytes
+              << " (" << memory.reserved_bytes << " reserved in " << memory.slabs << " slabs)" << std::endl;
+    std::cout << "   Fragmentation: " << std::fixed << std::setprecision(1)
+              << memory.internal_fragmentation() * 100.0 << "% size-class rounding, "
+              << memory.external_fragmentation() * 100.0 << "% free in slabs" << std::endl;
+    std::cout << "   Usage stayed within budget: " << (within_budget && memory.used_bytes <= budget ? "✓ PASS" : "✗ FAIL")
+              << std::endl;
+    
+    std::cout << "\n2. Checking recent contents and an oversized message..." << std::endl;
+    std::string content;
+    bool recent = cache.lookup("Sender" + std::to_string(49999 % 97) + "_" + std::to_string(base_time + 49999), content);
+    bool correct = recent && !content.empty() && content[0] == static_cast<char>('a' + 49999 % 26);
+    bool oversized = cache.insert("Huge", std::string(budget, 'x'), base_time);
+    std::cout << "   Latest message intact: " << (correct ? "✓ PASS" : "✗ FAIL") << std::endl;
+    std::cout << "   Oversized message rejected: " << (!oversized ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n3. Holding a handle across eviction, readers racing a writer..." << std::endl;
+    MessageCache small(CacheByteBudget{64 * 1024}, EvictionPolicyType::LRU, 1);
+    small.insert("Holder", "Held message", base_time);
+    CachedContent held = small.lookup("Holder_" + std::to_string(base_time));
+    std::atomic<bool> done(false);
+    std::atomic<int> wrong_content(0);
+    auto reader = [&](int reader_id) {
+        while (!done.load()) {
+            for (int i = 0; i < 1000; i++) {
+                std::string msg_id = "W_" + std::to_string(base_time + (i * 7 + reader_id) % 20000);
+                CachedContent hit = small.lookup(msg_id);
+                if (hit && hit.view() != msg_id) {
+                    wrong_content++;
+                }
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back(reader, t);
+    }
+    for (int i = 0; i < 20000; i++) {
+        std::string msg_id = "W_" + std::to_string(base_time + i);
+        small.insert("W", msg_id, base_time + i);
+    }
+    done = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+    bool evicted = !small.lookup("Holder_" + std::to_string(base_time));
+    bool intact = held && held.view() == "Held message";
+    std::cout << "   Entry evicted, handle still valid: " << (evicted && intact ? "✓ PASS" : "✗ FAIL") << std::endl;
+    std::cout << "   Hits with wrong content: " << wrong_content.load()
+              << (wrong_content.load() == 0 ? " ✓ PASS" : " ✗ FAIL") << std::endl;
+    
+    std::cout << "\n4. Handles pinning slabs while the cache turns over..." << std::endl;
+    const size_t pinned_budget = 64 * 1024;
+    MessageCache pinned(CacheByteBudget{pinned_budget}, EvictionPolicyType::LRU, 1);
+    std::vector<CachedContent> handles;
+    size_t peak_charged = 0;
+    size_t peak_deferred = 0;
+    for (int i = 0; i < 20000; i++) {
+        std::string msg_id = "P_" + std::to_string(base_time + i);
+        pinned.insert("P", msg_id, base_time + i);
+        if (i % 25 == 0) {
+            handles.push_back(pinned.lookup(msg_id));
+        }
+        // Every fourth recent message stays hot, so evictions leave holes in pinned slabs
+        for (int j = i - i % 4; j > i - 400 && j >= 0; j -= 4) {
+            pinned.update_access(MessageKey("P", base_time + j));
+        }
+        CacheMemoryStats stats = pinned.get_memory_stats();
+        peak_charged = std::max(peak_charged, stats.used_bytes + stats.deferred_bytes);
+        peak_deferred = std::max(peak_deferred, stats.deferred_bytes);
+    }
+    // Blocks freed by a reclaim batch are charged from the next insert on
+    CacheMemoryStats pinned_memory = pinned.get_memory_stats();
+    size_t batch_bytes = CACHE_RECLAIM_BATCH * (pinned_memory.used_bytes / pinned.get_size());
+    std::cout << "   Peak: " << peak_deferred << " bytes deferred, " << peak_charged << " cached plus deferred"
+              << std::endl;
+    std::cout << "   Deferred blocks charged against the budget: "
+              << (peak_deferred > 0 && peak_charged <= pinned_budget + batch_bytes ? "✓ PASS" : "✗ FAIL")
+              << std::endl;
+    handles.clear();
+    pinned.insert("P", "After the handles", base_time + 20000);
+    pinned_memory = pinned.get_memory_stats();
+    std::cout << "   Released handles free their blocks: "
+              << (pinned_memory.deferred_bytes == 0 && pinned_memory.deferred_blocks == 0 ? "✓ PASS" : "✗ FAIL")
+              << std::endl;
+    
+    cache.clear();
+    memory = cache.get_memory_stats();
+    std::cout << "\n5. After clear: " << memory.used_bytes << " bytes used, " << memory.slabs << " slabs "
+              << (memory.used_bytes == 0 && memory.slabs == 0 ? "✓ PASS" : "✗ FAIL") << std::endl;
+}
+
+void test_ttl_expiry() {
+    print_test_header("TTL Expiry");
+    
+    MessageCache cache(1000);
+    time_t now = time(nullptr);
+    cache.set_default_ttl(30);
+    
+    std::cout << "\n1. Per-entry and default TTLs..." << std::endl;
+    cache.insert("Short", "Expires in 10s", now, 10);
+    cache.insert("Long", "Expires in 100s", now, 100);
+    cache.insert("Forever", "Never expires", now, 0);
+    cache.insert("Default", "Expires in 30s", now);
+    cache.expire(now + 11);
+    bool step1 = !cache.lookup("Short_" + std::to_string(now)) && cache.get_size() == 3;
+    cache.expire(now + 31);
+    bool step2 = !cache.lookup("Default_" + std::to_string(now)) && cache.get_size() == 2;
+    cache.expire(now + 101);
+    bool step3 = cache.lookup("Forever_" + std::to_string(now)) && cache.get_size() == 1;
+    std::cout << "   Expired in deadline order: " << (step1 && step2 && step3 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    std::cout << "   Expired count: " << cache.get_expired() << (cache.get_expired() == 3 ? " ✓ PASS" : " ✗ FAIL")
+              << std::endl;
+    
+    std::cout << "\n2. 5000 random TTLs of 1s - 6h, expired in steps..." << std::endl;
+    MessageCache wheel_cache(20000);  // Roomy enough that no shard evicts
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> ttl_dist(1, 6 * 3600);
+    std::vector<int> ttls;
+    for (int i = 0; i < 5000; i++) {
+        ttls.push_back(ttl_dist(rng));
+        wheel_cache.insert("Timed", "Timed message", now + i, ttls.back());
+    }
+    bool exact = true;
+    for (int elapsed : {1, 63, 64, 65, 4095, 4096, 4097, 10000, 6 * 3600}) {
+        wheel_cache.expire(now + elapsed);
+        // The wheel started up to a second before the inserts
+        int alive_min = 0, alive_max = 0;
+        for (int ttl : ttls) {
+            alive_min += ttl > elapsed ? 1 : 0;
+            alive_max += ttl >= elapsed ? 1 : 0;
+        }
+        int size = wheel_cache.get_size();
+        exact = exact && size >= alive_min && size <= alive_max;
+    }
+    std::cout << "   Remaining entries matched deadlines at every step: " << (exact ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n3. TTL beyond the wheel's horizon, and eviction of timed entries..." << std::endl;
+    MessageCache far_cache(2);
+    const time_t day = 24 * 3600;
+    far_cache.insert("Evicted", "Evicted before it expires", now, 5);
+    far_cache.insert("Far", "Expires in 300 days", now, 300 * day);
+    far_cache.insert("Evictor", "Takes its slot", now, 5);
+    far_cache.expire(now + 200 * day);
+    bool parked = far_cache.lookup("Far_" + std::to_string(now)) && far_cache.get_size() == 1;
+    far_cache.expire(now + 301 * day);
+    bool far_expired = far_cache.get_size() == 0 && far_cache.get_expired() == 2;
+    std::cout << "   Far deadline kept, then expired: " << (parked && far_expired ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n4. Background expiry thread (1s TTL)..." << std::endl;
+    MessageCache ticking(100);
+    ticking.start_expiry();
+    ticking.insert("Tick", "Expires in 1s", time(nullptr), 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+    bool ticked = ticking.get_size() == 0;
+    std::cout << "   Expired without a lookup: " << (ticked ? "✓ PASS" : "✗ FAIL") << std::endl;
+}
+
+void test_batched_operations() {
+    print_test_header("Batched Lookups, Inserts and Touches");
+    
+    std::cout << "\n1. insert_many and lookup_many across 16 shards..." << std::endl;
+    MessageCache cache(2000, EvictionPolicyType::LRU, 16);
+    time_t base_time = time(nullptr);
+    std::vector<std::string> senders;
+    for (int i = 0; i < 100; i++) {
+        senders.push_back("Batch" + std::to_string(i % 7));
+    }
+    std::vector<CacheInsert> messages;
+    for (int i = 0; i < 100; i++) {
+        messages.push_back({senders[i], std::make_shared<const std::string>("Batch message " + std::to_string(i)),
+                            base_time + i});
+    }
+    size_t inserted = cache.insert_many(messages.data(), messages.size());
+    size_t again = cache.insert_many(messages.data(), 10);
+    std::cout << "   Inserted " << inserted << "/100, duplicates rejected: "
+              << (inserted == 100 && again == 0 && cache.get_size() == 100 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    // Every other key is absent
+    std::vector<MessageKey> keys;
+    for (int i = 0; i < 200; i++) {
+        keys.emplace_back(senders[i / 2], base_time + i / 2 + (i % 2 ? 1000 : 0));
+    }
+    std::vector<CachedContent> results(keys.size());
+    size_t hits = cache.lookup_many(keys.data(), keys.size(), results.data());
+    bool matched = hits == 100;
+    for (int i = 0; i < 200; i++) {
+        bool expected = i % 2 == 0;
+        matched = matched && static_cast<bool>(results[i]) == expected &&
+                  (!expected || results[i].view() == "Batch message " + std::to_string(i / 2));
+    }
+    std::cout << "   " << hits << " hits, every result in key order: " << (matched ? "✓ PASS" : "✗ FAIL")
+              << std::endl;
+    std::cout << "   Counted as 100 hits, 100 misses: "
+              << (cache.get_hits() == 100 && cache.get_misses() == 100 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n2. touch_many protects entries from LRU eviction..." << std::endl;
+    MessageCache lru(10);
+    std::vector<MessageKey> first_half;
+    for (int i = 0; i < 10; i++) {
+        lru.insert("Touched", "Message " + std::to_string(i), base_time + i);
+    }
+    for (int i = 0; i < 5; i++) {
+        first_half.emplace_back("Touched", base_time + i);
+    }
+    first_half.emplace_back("Touched", base_time + 500);  // Not cached
+    size_t touched = lru.touch_many(first_half.data(), first_half.size());
+    for (int i = 10; i < 15; i++) {
+        lru.insert("Touched", "Message " + std::to_string(i), base_time + i);
+    }
+    std::vector<CachedContent> kept(5);
+    bool survived = touched == 5 && lru.lookup_many(first_half.data(), 5, kept.data()) == 5;
+    std::cout << "   Touched " << touched << "/5, all survived 5 evictions: " << (survived ? "✓ PASS" : "✗ FAIL")
+              << std::endl;
+}
+
+void test_negative_filter() {
+    print_test_header("Negative Lookup Filter");
+    
+    std::cout << "\n1. 5000 cached messages, 100000 lookups of absent ones..." << std::endl;
+    MessageCache cache(10000);
+    cache.enable_negative_filter();
+    time_t base_time = time(nullptr);
+    for (int i = 0; i < 5000; i++) {
+        cache.insert("Present", "Message " + std::to_string(i), base_time + i);
+    }
+    int found = 0;
+    for (int i = 0; i < 5000; i++) {
+        found += cache.lookup(MessageKey("Present", base_time + i)) ? 1 : 0;
+    }
+    for (int i = 0; i < 100000; i++) {
+        cache.lookup(MessageKey("Absent", base_time + i));
+    }
+    double fpr = cache.get_filter_false_positive_rate();
+    std::cout << "   Every cached message found: " << (found == 5000 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    std::cout << "   False positive rate " << std::fixed << std::setprecision(2) << fpr << "% ("
+              << cache.get_filter_bytes() << " filter bytes): " << (fpr < 2.0 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n2. Eviction churn: filtered and unfiltered caches agree on every lookup..." << std::endl;
+    MessageCache filtered(1000, EvictionPolicyType::ARC);
+    MessageCache plain(1000, EvictionPolicyType::ARC);
+    filtered.enable_negative_filter();
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> key_dist(0, 4000);
+    bool agree = true;
+    for (int i = 0; i < 50000; i++) {
+        time_t ts = base_time + key_dist(rng);
+        if (i % 3 == 0) {
+            filtered.insert("Churn", "Churn message", ts);
+            plain.insert("Churn", "Churn message", ts);
+        } else {
+            agree = agree && static_cast<bool>(filtered.lookup(MessageKey("Churn", ts))) ==
+                                 static_cast<bool>(plain.lookup(MessageKey("Churn", ts)));
+        }
+    }
+    filtered.clear();
+    for (int i = 0; i < 1000; i++) {
+        filtered.lookup(MessageKey("Churn", base_time + i));
+    }
+    bool cleared = filtered.get_filtered() == 1000;
+    std::cout << "   No false negatives after evictions: " << (agree ? "✓ PASS" : "✗ FAIL") << std::endl;
+    std::cout << "   Cleared filter answers every lookup: " << (cleared ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n3. Lock-free readers while writers churn the filter..." << std::endl;
+    MessageCache shared(100000);
+    shared.enable_negative_filter();
+    for (int i = 0; i < 100; i++) {
+        shared.insert("Pinned", "Pinned message", base_time + i);
+    }
+    std::atomic<bool> stop{false};
+    std::atomic<int> missing{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 2; t++) {
+        threads.emplace_back([&shared, &stop, t, base_time]() {
+            for (int i = 0; !stop; i++) {
+                shared.insert("Writer" + std::to_string(t), "Churn", base_time + i);
+            }
+        });
+    }
+    for (int t = 0; t < 2; t++) {
+        threads.emplace_back([&shared, &missing, base_time]() {
+            for (int i = 0; i < 50000; i++) {
+                if (!shared.lookup(MessageKey("Pinned", base_time + i % 100))) {
+                    missing++;
+                }
+                shared.lookup(MessageKey("Nobody", base_time + i));
+            }
+        });
+    }
+    for (size_t t = 2; t < threads.size(); t++) {
+        threads[t].join();
+    }
+    stop = true;
+    threads[0].join();
+    threads[1].join();
+    std::cout << "   Cached messages never reported absent: " << (missing == 0 ? "✓ PASS" : "✗ FAIL") << std::endl;
+}
+
+void test_generic_cache() {
+    print_test_header("Generic Cache Template");
+    
+    std::cout << "\n1. Single-threaded user -> fd cache (LRU, NullLock)..." << std::endl;
+    using UserFdCache = Cache<std::string, int, std::hash<std::string>, std::equal_to<>, LruPolicy, NullLock>;
+    static_assert(!UserFdCache::concurrent, "NullLock compiles the locking out");
+    UserFdCache users(3);
+    users.insert("alice", 4);
+    users.insert("bob", 5);
+    users.insert("carol", 6);
+    users.update_access(std::string("alice"));
+    users.insert("dave", 7);
+    int fd = -1;
+    bool lru_order = users.lookup(std::string("alice"), fd) && fd == 4 && !users.lookup(std::string("bob"), fd);
+    bool duplicate = !users.insert("dave", 8) && users.lookup(std::string("dave"), fd) && fd == 7;
+    std::cout << "   Least recently used user evicted: " << (lru_order ? "✓ PASS" : "✗ FAIL") << std::endl;
+    std::cout << "   Duplicate key rejected: " << (duplicate ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n2. Weighted W-TinyLFU cache of strings (budget 1000)..." << std::endl;
+    Cache<int, std::string, std::hash<int>, std::equal_to<>, TinyLfuPolicy> weighted(100, 1000);
+    bool within = true;
+    for (int i = 0; i < 500; i++) {
+        std::string value(1 + i % 97, 'x');
+        weighted.insert(i, value, value.size());
+        within = within && weighted.get_weight() <= 1000;
+    }
+    bool oversized = !weighted.insert(1000, std::string(1001, 'y'), 1001);
+    std::cout << "   Weight stayed within budget (" << weighted.get_weight() << "/1000, " << weighted.get_size()
+              << " entries): " << (within ? "✓ PASS" : "✗ FAIL") << std::endl;
+    std::cout << "   Entry heavier than the budget rejected: " << (oversized ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n3. TTL on a generic cache..." << std::endl;
+    Cache<int, int> timed(10);
+    time_t now = time(nullptr);
+    timed.insert(1, 10, 1, 5);
+    timed.insert(2, 20);
+    timed.expire(now + 6);
+    int value = 0;
+    bool ttl_ok = !timed.lookup(1, value) && timed.lookup(2, value) && value == 20 && timed.get_expired() == 1;
+    std::cout << "   Timed entry expired, untimed one kept: " << (ttl_ok ? "✓ PASS" : "✗ FAIL") << std::endl;
+    
+    std::cout << "\n4. Concurrent readers and writers on a shared cache..." << std::endl;
+    Cache<int, std::string> shared(256);
+    std::atomic<bool> consistent{true};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&shared, &consistent, t]() {
+            for (int i = 0; i < 20000; i++) {
+                int key = (i * 7 + t) % 1024;
+                if (t % 2 == 0) {
+                    shared.insert(key, std::to_string(key));
+                } else {
+                    shared.visit(key, [&consistent, key](const std::string& cached) {
+                        if (cached != std::to_string(key)) {
+                            consistent = false;
+                        }
+                    });
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    bool bounded = shared.get_size() <= 256;
+    std::cout << "   Every hit matched its key, size bounded: "
+              << (consistent && bounded ? "✓ PASS" : "✗ FAIL") << std::endl;
+}
+
 void test_edge_cases() {
     print_test_header("Edge Cases and Stress Test");
     
@@ -224,9 +824,36 @@ int main() {
         test_cache_performance();
         std::cout << "\n\n";
         
+        test_large_capacity();
+        std::cout << "\n\n";
+        
         test_concurrent_access();
         std::cout << "\n\n";
         
+        test_sharded_concurrency();
+        std::cout << "\n\n";
+        
+        test_optimistic_reads();
+        std::cout << "\n\n";
+        
+        test_eviction_policies();
+        std::cout << "\n\n";
+        
+        test_byte_budget();
+        std::cout << "\n\n";
+        
+        test_ttl_expiry();
+        std::cout << "\n\n";
+        
+        test_batched_operations();
+        std::cout << "\n\n";
+        
+        test_negative_filter();
+        std::cout << "\n\n";
+        
+        test_generic_cache();
+        std::cout << "\n\n";
+        
         test_edge_cases();
         std::cout << "\n\n";
         
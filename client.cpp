@@ -1,7 +1,11 @@
 #include "common.h"
+#include "protocol.h"
+#include "frame_reader.h"
 #include <iostream>
 #include <cstring>
+#include <cerrno>
 #include <unistd.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -9,17 +13,96 @@
 #include <atomic>
 #include <string>
 #include <chrono>
+#include <vector>
+#include <algorithm>
 
 std::atomic<bool> client_running(true);
+uint8_t protocol_version = PROTOCOL_LEGACY;  // Negotiated in connect_to_server
+
+constexpr int HELLO_TIMEOUT_MS = 1000;
+
+// Read exactly length bytes, returning the last recv result on failure
+ssize_t recv_exact(int socket_fd, char* data, size_t length) {
+    size_t received = 0;
+    while (received < length) {
+        ssize_t bytes = recv(socket_fd, data + received, length - received, 0);
+        if (bytes <= 0) {
+            return bytes;
+        }
+        received += static_cast<size_t>(bytes);
+    }
+    return static_cast<ssize_t>(received);
+}
+
+void display_message(Message& msg) {
+    // Ensure null-terminated strings
+    msg.sender[sizeof(msg.sender) - 1] = '\0';
+    msg.payload[sizeof(msg.payload) - 1] = '\0';
+    
+    // Display message based on type
+    time_t timestamp = msg.timestamp;
+    char time_str[64];
+    struct tm* tm_info = localtime(&timestamp);
+    if (tm_info) {
+        strftime(time_str, sizeof(time_str), "%H:%M:%S", tm_info);
+    } else {
+        strncpy(time_str, "??:??:??", sizeof(time_str) - 1);
+    }
+    
+    switch (msg.type) {
+        case MSG_TEXT:
+            std::cout << "\n[" << time_str << "] " << msg.sender << ": " 
+                      << msg.payload << std::endl;
+            std::cout << "You: " << std::flush;
+            break;
+            
+        case MSG_JOIN:
+            std::cout << "\n[" << time_str << "] >>> " << msg.payload << std::endl;
+            std::cout << "You: " << std::flush;
+            break;
+            
+        case MSG_LEAVE:
+            std::cout << "\n[" << time_str << "] <<< " << msg.payload << std::endl;
+            std::cout << "You: " << std::flush;
+            break;
+            
+        case MSG_ROOM_JOIN:
+        case MSG_ROOM_LEAVE:
+        case MSG_ROOM_TEXT: {
+            // Payload is "<room> <text>"
+            std::string payload(msg.payload);
+            size_t space = payload.find(' ');
+            std::string room = payload.substr(0, space);
+            std::string text = (space == std::string::npos) ? "" : payload.substr(space + 1);
+            
+            std::cout << "\n[" << time_str << "] [#" << room << "] ";
+            if (msg.type == MSG_ROOM_TEXT) {
+                std::cout << msg.sender << ": " << text << std::endl;
+            } else {
+                std::cout << (msg.type == MSG_ROOM_JOIN ? ">>> " : "<<< ") << text << std::endl;
+            }
+            std::cout << "You: " << std::flush;
+            break;
+        }
+            
+        default:
+            // Unknown message type, ignore
+            break;
+    }
+}
 
 void receive_messages(int socket_fd) {
+    FrameReader reader(protocol_version);
     Message msg;
     
     while (client_running.load()) {
-        memset(&msg, 0, sizeof(msg));
-        ssize_t bytes = recv(socket_fd, &msg, sizeof(Message), 0);
+        // Take everything available; TCP may split or merge messages
+        ssize_t bytes = reader.fill(socket_fd);
         
         if (bytes <= 0) {
+            if (bytes < 0 && errno == EINTR) {
+                continue;
+            }
             // Connection closed or error
             if (client_running.load()) {
                 std::cout << "\n[Server disconnected]" << std::endl;
@@ -28,52 +111,34 @@ void receive_messages(int socket_fd) {
             break;
         }
         
-        if (bytes != sizeof(Message)) {
-            // Partial or invalid message received
-            continue;
+        DecodeStatus status;
+        while ((status = reader.next(msg)) == DecodeStatus::COMPLETE) {
+            display_message(msg);
         }
-        
-        // Ensure null-terminated strings
-        msg.sender[sizeof(msg.sender) - 1] = '\0';
-        msg.payload[sizeof(msg.payload) - 1] = '\0';
-        
-        // Display message based on type
-        time_t timestamp = msg.timestamp;
-        char time_str[64];
-        struct tm* tm_info = localtime(&timestamp);
-        if (tm_info) {
-            strftime(time_str, sizeof(time_str), "%H:%M:%S", tm_info);
-        } else {
-            strncpy(time_str, "??:??:??", sizeof(time_str) - 1);
+        if (status == DecodeStatus::INVALID) {
+            std::cout << "\n[Protocol error, disconnecting]" << std::endl;
+            client_running.store(false);
+            break;
         }
-        
-        switch (msg.type) {
-            case MSG_TEXT:
-                std::cout << "\n[" << time_str << "] " << msg.sender << ": " 
-                          << msg.payload << std::endl;
-                std::cout << "You: " << std::flush;
-                break;
-                
-            case MSG_JOIN:
-                std::cout << "\n[" << time_str << "] >>> " << msg.payload << std::endl;
-                std::cout << "You: " << std::flush;
-                break;
-                
-            case MSG_LEAVE:
-                std::cout << "\n[" << time_str << "] <<< " << msg.payload << std::endl;
-                std::cout << "You: " << std::flush;
-                break;
-                
-            default:
-                // Unknown message type, ignore
-                break;
+    }
+}
+
+bool send_all(int socket_fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(socket_fd, data, length, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
         }
+        data += sent;
+        length -= static_cast<size_t>(sent);
     }
+    return true;
 }
 
 void send_messages(int socket_fd, const std::string& user_id) {
     std::string input;
     Message msg;
+    uint32_t sequence = 0;
     
     while (client_running.load()) {
         std::cout << "You: " << std::flush;
@@ -95,8 +160,11 @@ void send_messages(int socket_fd, const std::string& user_id) {
         // Check for help command
         if (input == "/help") {
             std::cout << "\nAvailable commands:" << std::endl;
-            std::cout << "  /quit, /exit - Disconnect from chat" << std::endl;
-            std::cout << "  /help        - Show this help message" << std::endl;
+            std::cout << "  /quit, /exit        - Disconnect from chat" << std::endl;
+            std::cout << "  /help               - Show this help message" << std::endl;
+            std::cout << "  /join <room>        - Join a room" << std::endl;
+            std::cout << "  /leave <room>       - Leave a room" << std::endl;
+            std::cout << "  /room <room> <text> - Send a message to a room you joined" << std::endl;
             std::cout << std::endl;
             continue;
         }
@@ -113,15 +181,29 @@ void send_messages(int socket_fd, const std::string& user_id) {
             input = input.substr(0, BUFFER_SIZE - 1);
         }
         
-        // Send text message
-        memset(&msg, 0, sizeof(msg));
-        msg.type = MSG_TEXT;
+        // Room commands carry the room at the front of the payload
+        uint8_t type = MSG_TEXT;
+        std::string payload = input;
+        if (input.rfind("/join ", 0) == 0) {
+            type = MSG_ROOM_JOIN;
+            payload = input.substr(6);
+        } else if (input.rfind("/leave ", 0) == 0) {
+            type = MSG_ROOM_LEAVE;
+            payload = input.substr(7);
+        } else if (input.rfind("/room ", 0) == 0) {
+            type = MSG_ROOM_TEXT;
+            payload = input.substr(6);
+        }
+        
+        // Send message
+        msg = Message();
+        msg.type = type;
         msg.set_sender(user_id);
-        msg.set_payload(input);
+        msg.set_payload(payload);
         msg.timestamp = time(nullptr);
         
-        ssize_t sent = send(socket_fd, &msg, sizeof(Message), MSG_NOSIGNAL);
-        if (sent <= 0) {
+        std::vector<char> frame = encode_message(msg, protocol_version, ++sequence);
+        if (!send_all(socket_fd, frame.data(), frame.size())) {
             std::cout << "\n[ERROR] Failed to send message" << std::endl;
             client_running.store(false);
             break;
@@ -129,6 +211,47 @@ void send_messages(int socket_fd, const std::string& user_id) {
     }
 }
 
+// Wait briefly for the server's hello acknowledgement. Legacy servers never
+// send one, so anything else (or silence) means the legacy protocol.
+uint8_t negotiate_protocol(int socket_fd) {
+    char ack[PROTOCOL_ACK_SIZE];
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(HELLO_TIMEOUT_MS);
+    
+    while (true) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) {
+            return PROTOCOL_LEGACY;
+        }
+        
+        struct pollfd pfd;
+        pfd.fd = socket_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, static_cast<int>(remaining)) <= 0) {
+            return PROTOCOL_LEGACY;
+        }
+        
+        ssize_t bytes = recv(socket_fd, ack, sizeof(ack), MSG_PEEK);
+        if (bytes <= 0) {
+            return PROTOCOL_LEGACY;
+        }
+        if (memcmp(ack, PROTOCOL_MAGIC, std::min(static_cast<size_t>(bytes), sizeof(PROTOCOL_MAGIC))) != 0) {
+            // Start of a legacy Message, leave it for the receiver
+            return PROTOCOL_LEGACY;
+        }
+        
+        uint8_t version;
+        if (static_cast<size_t>(bytes) == sizeof(ack) && parse_hello_ack(ack, sizeof(ack), version)) {
+            recv_exact(socket_fd, ack, sizeof(ack));
+            return version;
+        }
+        
+        // Partial acknowledgement, wait for the rest
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
 bool connect_to_server(const std::string& server_ip, int server_port, 
                        const std::string& user_id, int& client_socket) {
     // Create socket
@@ -161,14 +284,15 @@ bool connect_to_server(const std::string& server_ip, int server_port,
     
     std::cout << "Connected to server!" << std::endl;
     
-    // Send user ID to server
-    ssize_t sent = send(client_socket, user_id.c_str(), user_id.length(), MSG_NOSIGNAL);
-    if (sent <= 0) {
+    // Send user ID to server, offering the framed protocol
+    std::vector<char> hello = encode_hello(user_id, PROTOCOL_VERSION);
+    if (!send_all(client_socket, hello.data(), hello.size())) {
         std::cerr << "ERROR: Failed to send user ID to server" << std::endl;
         close(client_socket);
         return false;
     }
     
+    protocol_version = negotiate_protocol(client_socket);
     return true;
 }
 
@@ -230,6 +354,7 @@ int main(int argc, char* argv[]) {
     }
     
     std::cout << "\nWelcome to the chat, " << user_id << "!" << std::endl;
+    std::cout << "(protocol v" << static_cast<int>(protocol_version) << ")" << std::endl;
     std::cout << "Type /help for available commands" << std::endl;
     std::cout << "Type /quit to disconnect\n" << std::endl;
     
@@ -0,0 +1,78 @@
+#include "client_registry.h"
+#include <algorithm>
+
+namespace {
+
+bool fd_less(const std::shared_ptr<ClientInfo>& client, int socket_fd) {
+    return client->socket_fd < socket_fd;
+}
+
+}  // namespace
+
+ClientInfo* ClientRegistry::ReadGuard::find(int socket_fd) const {
+    auto it = std::lower_bound(snapshot->begin(), snapshot->end(), socket_fd, fd_less);
+    if (it == snapshot->end() || (*it)->socket_fd != socket_fd) {
+        return nullptr;
+    }
+    return it->get();
+}
+
+ClientRegistry::ClientRegistry() : current(new ClientSnapshot()) {}
+
+ClientRegistry::~ClientRegistry() {
+    delete current.load();
+}
+
+void ClientRegistry::publish(const ClientSnapshot* next) {
+    const ClientSnapshot* old = current.exchange(next, std::memory_order_acq_rel);
+    retired.retire(old);
+    retired.reclaim();
+}
+
+void ClientRegistry::add(std::shared_ptr<ClientInfo> client) {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+
+    auto next = new ClientSnapshot(*current.load(std::memory_order_relaxed));
+    auto it = std::lower_bound(next->begin(), next->end(), client->socket_fd, fd_less);
+    if (it != next->end() && (*it)->socket_fd == client->socket_fd) {
+        *it = std::move(client);
+    } else {
+        next->insert(it, std::move(client));
+    }
+    publish(next);
+}
+
+std::shared_ptr<ClientInfo> ClientRegistry::remove(int socket_fd) {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+
+    const ClientSnapshot* snapshot = current.load(std::memory_order_relaxed);
+    auto it = std::lower_bound(snapshot->begin(), snapshot->end(), socket_fd, fd_less);
+    if (it == snapshot->end() || (*it)->socket_fd != socket_fd) {
+        return nullptr;
+    }
+
+    std::shared_ptr<ClientInfo> removed = *it;
+    auto next = new ClientSnapshot();
+    next->reserve(snapshot->size() - 1);
+    next->insert(next->end(), snapshot->begin(), it);
+    next->insert(next->end(), it + 1, snapshot->end());
+    publish(next);
+    return removed;
+}
+
+ClientSnapshot ClientRegistry::clear() {
+    std::lock_guard<std::mutex> lock(writer_mutex);
+
+    ClientSnapshot last = *current.load(std::memory_order_relaxed);
+    publish(new ClientSnapshot());
+    return last;
+}
+
+std::shared_ptr<ClientInfo> ClientRegistry::find(int socket_fd) {
+    ReadGuard guard(*this);
+    auto it = std::lower_bound(guard.begin(), guard.end(), socket_fd, fd_less);
+    if (it == guard.end() || (*it)->socket_fd != socket_fd) {
+        return nullptr;
+    }
+    return *it;
+}
@@ -0,0 +1,75 @@
+#ifndef CLIENT_REGISTRY_H
+#define CLIENT_REGISTRY_H
+
+#include "common.h"
+#include "epoch.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Immutable list of connected clients, sorted by socket_fd
+using ClientSnapshot = std::vector<std::shared_ptr<ClientInfo>>;
+
+/**
+ * Connected-client table published as immutable snapshots (RCU style)
+ * Readers take no lock: an Epoch::Guard pins whatever snapshot they load.
+ * Writers are serialised by a mutex: each copies the snapshot, swaps the
+ * pointer, and retires the old one, which is freed once no reader that
+ * could have loaded it is left.
+ */
+class ClientRegistry {
+private:
+    std::atomic<const ClientSnapshot*> current;
+    std::mutex writer_mutex;
+    RetireList<const ClientSnapshot> retired;
+
+    // Private helper methods
+    void publish(const ClientSnapshot* next);
+
+public:
+    // Pins one snapshot for as long as it lives; keep it short
+    class ReadGuard {
+    private:
+        Epoch::Guard epoch;
+        const ClientSnapshot* snapshot;
+
+    public:
+        explicit ReadGuard(ClientRegistry& owner)
+            : snapshot(owner.current.load(std::memory_order_acquire)) {}
+
+        // Delete copy constructor and assignment operator
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        ClientSnapshot::const_iterator begin() const { return snapshot->begin(); }
+        ClientSnapshot::const_iterator end() const { return snapshot->end(); }
+        size_t size() const { return snapshot->size(); }
+
+        // nullptr if the socket is not registered in this snapshot
+        ClientInfo* find(int socket_fd) const;
+    };
+
+    ClientRegistry();
+    ~ClientRegistry();
+
+    // Delete copy constructor and assignment operator
+    ClientRegistry(const ClientRegistry&) = delete;
+    ClientRegistry& operator=(const ClientRegistry&) = delete;
+
+    ReadGuard read() { return ReadGuard(*this); }
+
+    // Publish a snapshot with client added (replacing any entry for its fd)
+    void add(std::shared_ptr<ClientInfo> client);
+
+    // Publish a snapshot without the socket; returns the removed entry
+    std::shared_ptr<ClientInfo> remove(int socket_fd);
+
+    // Publish an empty snapshot; returns the last one
+    ClientSnapshot clear();
+
+    // Keeps the entry alive after the read ends
+    std::shared_ptr<ClientInfo> find(int socket_fd);
+};
+
+#endif
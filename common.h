@@ -5,15 +5,57 @@
 #include <cstdint>
 #include <ctime>
 #include <cstring>
+#include <memory>
+#include <vector>
+#include <atomic>
 
 // Server configuration
 constexpr int SERVER_PORT = 8080;
 constexpr int MAX_CLIENTS = 50;
 constexpr int THREAD_POOL_SIZE = 6;
+constexpr size_t THREAD_POOL_QUEUE_CAPACITY = 1024;  // Lock-free task ring slots (power of two); a burst beyond it spills to a locked list
+constexpr int THREAD_POOL_SPIN_ROUNDS = 64;          // Empty polls an idle worker makes before it parks
+constexpr size_t THREAD_POOL_TASK_INLINE_SIZE = 64;  // Bytes of captures a queued task holds without a heap allocation
+constexpr size_t THREAD_POOL_SPARE_TASKS = 256;      // Emptied deque task nodes a worker keeps for reuse
+constexpr int THREAD_POOL_MONITOR_INTERVAL_MS = 10;  // How often an elastic pool checks its backlog
+constexpr int THREAD_POOL_GROW_WAIT_MS = 50;         // Estimated queue wait at which an elastic pool adds a worker
+constexpr int THREAD_POOL_IDLE_TIMEOUT_MS = 10000;   // Idle time after which a worker above the minimum retires
 constexpr int BUFFER_SIZE = 4096;
 constexpr int CACHE_SIZE = 10;
 constexpr int TIME_QUANTUM_MS = 100;
 constexpr int USERNAME_MAX_LEN = 63;  // 64 - 1 for null terminator
+constexpr int MAX_EVENTS = 64;        // epoll events fetched per wakeup
+constexpr int EPOLL_TIMEOUT_MS = 1000;
+constexpr size_t FRAME_READER_CAPACITY = 65536;  // Per-connection receive ring
+constexpr int URING_QUEUE_DEPTH = 256;
+constexpr int URING_BUFFER_COUNT = 256;   // Provided recv buffers (power of two)
+constexpr int URING_BUFFER_SIZE = 8192;
+constexpr int URING_BUFFER_GROUP = 0;
+constexpr unsigned URING_COMPLETION_BATCH = 32;  // CQEs handled between outbound flushes
+constexpr size_t OUTBOUND_IOV_MAX = 64;       // Segments gathered into one sendmsg
+constexpr size_t OUTBOUND_QUEUE_LIMIT = 256;  // Frames buffered per client before the slow-consumer policy applies
+constexpr size_t ROOM_INDEX_SHARDS = 16;
+constexpr size_t ROOM_NAME_MAX_LEN = 32;
+constexpr size_t MAX_ROOMS_PER_CLIENT = 16;
+constexpr size_t EPOCH_MAX_THREADS = 256;     // Threads that can hold epoch guards over the process lifetime at once
+constexpr size_t LOG_RECORD_SIZE = 256;     // Bytes per log record, text is truncated to fit
+constexpr size_t LOG_RING_CAPACITY = 1024;  // Records buffered per logging thread
+constexpr int LOG_FLUSH_INTERVAL_MS = 20;   // Longest a record waits when the logger is idle
+constexpr int CACHE_SHARDS = 16;               // Upper bound on independently locked cache shards
+constexpr int CACHE_MIN_SHARD_CAPACITY = 64;   // Smaller caches use fewer shards (one below this)
+constexpr size_t CACHE_RECLAIM_BATCH = 64;     // Evicted entries a shard holds before freeing what readers have left
+constexpr size_t CACHE_SLAB_SIZE = 64 * 1024;  // Largest arena slab (byte-budget mode)
+constexpr size_t CACHE_SLABS_PER_BUDGET = 32;   // Smaller shard budgets get slabs of budget / this
+constexpr size_t CACHE_MIN_BLOCK_SIZE = 64;     // Smallest arena size class
+constexpr int CACHE_SKETCH_DEPTH = 4;             // Count-min sketch rows (W-TinyLFU admission)
+constexpr size_t CACHE_TINYLFU_WINDOW_PERCENT = 1;      // Share of a W-TinyLFU shard given to the admission window
+constexpr size_t CACHE_TINYLFU_PROTECTED_PERCENT = 80;  // Share of the main area reserved for re-used entries
+constexpr time_t CACHE_DEFAULT_TTL = 0;          // Seconds a cached message lives; 0 keeps it until evicted
+constexpr int CACHE_WHEEL_LEVELS = 4;            // Timer wheel levels; 64^4 seconds (~194 days) ahead
+constexpr int CACHE_WHEEL_SLOT_BITS = 6;         // 64 slots per timer wheel level
+constexpr int CACHE_EXPIRY_TICK_MS = 1000;       // How often the expiry thread advances the wheels
+constexpr size_t CACHE_FILTER_COUNTERS_PER_ENTRY = 16;  // Negative-filter counters per cache entry (~0.5% false positives)
+constexpr int CACHE_FILTER_HASHES = 4;                  // Counters each key sets, all in one cache line
 
 // Message types
 enum class MessageType : uint8_t {
@@ -23,7 +65,10 @@ enum class MessageType : uint8_t {
     AUDIO = 0x04,
     VIDEO = 0x05,
     STATUS = 0x06,
-    CACHE_TEST = 0x07  // New type for cache testing
+    CACHE_TEST = 0x07,  // New type for cache testing
+    ROOM_JOIN = 0x08,   // Payload: "<room>" from clients, "<room> <notice>" to them
+    ROOM_LEAVE = 0x09,
+    ROOM_TEXT = 0x0A    // Payload: "<room> <text>"
 };
 
 // Legacy defines for backward compatibility
@@ -34,6 +79,9 @@ enum class MessageType : uint8_t {
 #define MSG_VIDEO static_cast<uint8_t>(MessageType::VIDEO)
 #define MSG_STATUS static_cast<uint8_t>(MessageType::STATUS)
 #define MSG_CACHE_TEST static_cast<uint8_t>(MessageType::CACHE_TEST)
+#define MSG_ROOM_JOIN static_cast<uint8_t>(MessageType::ROOM_JOIN)
+#define MSG_ROOM_LEAVE static_cast<uint8_t>(MessageType::ROOM_LEAVE)
+#define MSG_ROOM_TEXT static_cast<uint8_t>(MessageType::ROOM_TEXT)
 
 // Message structure with better memory alignment
 struct Message {
@@ -65,28 +113,47 @@ struct Message {
     }
 };
 
-// Cache entry structure
+// Bookkeeping at the start of every cache node (Cache<> in generic_cache.h
+// derives its nodes from it): the key's hash, the eviction policy's links
+// and the timer wheel's. Lock-free readers only use hash; the rest belongs
+// to the cache's writer
 struct CacheEntry {
-    std::string message_id;
-    std::string content;
-    std::string sender;
-    time_t timestamp;
-    time_t last_access;
-    int access_count;
-    bool valid;
+    uint64_t hash;
+    uint32_t weight;           // Share of the cache's weight budget
+    uint16_t timer_slot;       // Timer wheel slot, TIMER_UNSCHEDULED if none
+    uint8_t policy_state;      // Eviction policy's list or reference bit
+    CacheEntry* policy_prev;   // Eviction policy's list links, nullptr at the ends
+    CacheEntry* policy_next;
+    time_t expires_at;         // 0 if the entry never expires
+    CacheEntry* timer_prev;    // Timer wheel slot links, nullptr at the ends
+    CacheEntry* timer_next;
+    
+    static constexpr uint16_t TIMER_UNSCHEDULED = 0xFFFF;
     
-    CacheEntry() : timestamp(0), last_access(0), access_count(0), valid(false) {}
+    CacheEntry() : hash(0), weight(0), timer_slot(TIMER_UNSCHEDULED), policy_state(0), policy_prev(nullptr),
+                   policy_next(nullptr), expires_at(0), timer_prev(nullptr), timer_next(nullptr) {}
 };
 
-// Client information
+class OutboundQueue;
+
+// Client information, shared by every registry snapshot that lists the client
 struct ClientInfo {
     int socket_fd;
     std::string user_id;
     time_t connect_time;
-    time_t last_active;
-    bool active;
+    std::atomic<time_t> last_active;  // Written on every message, no lock
+    std::atomic<bool> active;
+    uint8_t protocol_version;  // Wire format negotiated at connect (see protocol.h)
+    std::shared_ptr<OutboundQueue> outbound;  // Frames waiting for the socket (see outbound_queue.h)
+    int shard;                 // Event loop that owns the socket in sharded mode, -1 otherwise
+    std::vector<std::string> rooms;  // Rooms joined; only the connection's own handler touches it
+    
+    ClientInfo() : socket_fd(-1), connect_time(0), last_active(0), active(false),
+                   protocol_version(0), shard(-1) {}
     
-    ClientInfo() : socket_fd(-1), connect_time(0), last_active(0), active(false) {}
+    // Delete copy constructor and assignment operator
+    ClientInfo(const ClientInfo&) = delete;
+    ClientInfo& operator=(const ClientInfo&) = delete;
 };
 
 // Performance metrics
@@ -97,12 +164,18 @@ struct PerformanceMetrics {
     uint64_t cache_misses;
     uint64_t page_faults_minor;
     uint64_t page_faults_major;
+    uint64_t messages_dropped;       // Frames discarded by the slow-consumer policy
+    uint64_t slow_consumer_disconnects;
+    uint64_t outbound_queued;        // Frames currently waiting in client queues
+    uint64_t outbound_high_water;    // Deepest any client queue has been
     int active_threads;
     int active_clients;
     
     PerformanceMetrics() : messages_sent(0), messages_received(0), 
                            cache_hits(0), cache_misses(0),
                            page_faults_minor(0), page_faults_major(0),
+                           messages_dropped(0), slow_consumer_disconnects(0),
+                           outbound_queued(0), outbound_high_water(0),
                            active_threads(0), active_clients(0) {}
 };
 
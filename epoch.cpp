@@ -0,0 +1,97 @@
+#include "epoch.h"
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+struct alignas(64) ThreadSlot {
+    std::atomic<uint64_t> epoch;  // 0 outside a guard, else the epoch the reader entered in
+    std::atomic<bool> owned;
+
+    constexpr ThreadSlot() : epoch(0), owned(false) {}
+};
+
+// Constant-initialised, so usable from any static constructor or destructor
+ThreadSlot slots[EPOCH_MAX_THREADS];
+std::atomic<size_t> slots_in_use(0);  // High-water mark bounding the scan
+std::atomic<uint64_t> global_epoch(1);
+
+// Claims a slot on first use and frees it when the thread exits
+struct SlotHolder {
+    size_t index = EPOCH_MAX_THREADS;
+    uint32_t depth = 0;
+
+    ~SlotHolder() {
+        if (index < EPOCH_MAX_THREADS) {
+            slots[index].epoch.store(0, std::memory_order_release);
+            slots[index].owned.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local SlotHolder holder;
+
+size_t claim_slot() {
+    for (size_t i = 0; i < EPOCH_MAX_THREADS; ++i) {
+        bool expected = false;
+        if (!slots[i].owned.load(std::memory_order_relaxed) &&
+            slots[i].owned.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            size_t in_use = slots_in_use.load(std::memory_order_relaxed);
+            while (in_use < i + 1 &&
+                   !slots_in_use.compare_exchange_weak(in_use, i + 1, std::memory_order_acq_rel)) {
+            }
+            return i;
+        }
+    }
+    throw std::runtime_error("More than EPOCH_MAX_THREADS threads are using epoch reclamation");
+}
+
+}  // namespace
+
+Epoch::Guard::Guard() {
+    if (holder.depth++ > 0) {
+        return;
+    }
+
+    size_t index = thread_index();
+    slots[index].epoch.store(global_epoch.load(std::memory_order_seq_cst), std::memory_order_relaxed);
+    // Pairs with the fence in synchronize(): either the writer sees this
+    // announcement, or this reader sees everything unlinked before it
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+Epoch::Guard::~Guard() {
+    if (--holder.depth == 0) {
+        slots[holder.index].epoch.store(0, std::memory_order_release);
+    }
+}
+
+uint64_t Epoch::retire_tag() {
+    // Order the caller's unlink before the epoch it is tagged with
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return global_epoch.load(std::memory_order_seq_cst);
+}
+
+uint64_t Epoch::synchronize() {
+    // Readers entering from here on announce an epoch above every tag handed out so far
+    global_epoch.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    size_t in_use = slots_in_use.load(std::memory_order_acquire);
+    for (size_t i = 0; i < in_use; ++i) {
+        uint64_t epoch = slots[i].epoch.load(std::memory_order_acquire);
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    return oldest;
+}
+
+size_t Epoch::thread_index() {
+    if (holder.index == EPOCH_MAX_THREADS) {
+        holder.index = claim_slot();
+    }
+    return holder.index;
+}
@@ -0,0 +1,86 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include "common.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+/**
+ * Process-wide epoch-based reclamation
+ * A reader holds an Epoch::Guard while it dereferences shared objects; the
+ * guard announces the current epoch in a slot owned by the calling thread,
+ * so entering and leaving writes no shared memory. Writers unlink an object,
+ * hand it to a RetireList, and the object is freed once every announced
+ * epoch is newer than the one it was retired in.
+ */
+class Epoch {
+public:
+    // Pins every object reachable when it is created; guards may nest
+    class Guard {
+    public:
+        Guard();
+        ~Guard();
+
+        // Delete copy constructor and assignment operator
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    // Tag for an object the caller has just unlinked
+    static uint64_t retire_tag();
+
+    // Advance the epoch and return the oldest epoch an active reader
+    // announced (UINT64_MAX if none); objects tagged below it are free
+    static uint64_t synchronize();
+
+    // Small per-thread index (below EPOCH_MAX_THREADS) for striped counters
+    static size_t thread_index();
+};
+
+// Objects waiting for the readers that may still hold them; writer side only
+template <typename T, typename Deleter = std::default_delete<T>>
+class RetireList {
+private:
+    struct Retired {
+        T* object;
+        uint64_t epoch;
+    };
+
+    std::vector<Retired> retired;
+    Deleter deleter;
+
+public:
+    explicit RetireList(Deleter free_object = Deleter()) : deleter(free_object) {}
+
+    // The owner guarantees no reader is left when it is destroyed
+    ~RetireList() {
+        for (const Retired& entry : retired) {
+            deleter(entry.object);
+        }
+    }
+
+    // Delete copy constructor and assignment operator
+    RetireList(const RetireList&) = delete;
+    RetireList& operator=(const RetireList&) = delete;
+
+    void retire(T* object) { retired.push_back({object, Epoch::retire_tag()}); }
+
+    void reclaim() {
+        if (retired.empty()) {
+            return;
+        }
+
+        uint64_t oldest = Epoch::synchronize();
+        auto still_visible = std::partition(retired.begin(), retired.end(),
+                                            [oldest](const Retired& entry) { return entry.epoch >= oldest; });
+        for (auto it = still_visible; it != retired.end(); ++it) {
+            deleter(it->object);
+        }
+        retired.erase(still_visible, retired.end());
+    }
+
+    size_t size() const { return retired.size(); }
+};
+
+#endif
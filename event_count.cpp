@@ -0,0 +1,84 @@
+#include "event_count.h"
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t), "futex needs the plain state word");
+
+namespace {
+
+constexpr int EPOCH_SHIFT = 32;
+constexpr uint64_t WAITER_MASK = (uint64_t(1) << EPOCH_SHIFT) - 1;
+
+uint32_t epoch_of(uint64_t state) {
+    return static_cast<uint32_t>(state >> EPOCH_SHIFT);
+}
+
+}  // namespace
+
+uint32_t* EventCount::epoch_word() {
+    uint32_t* halves = reinterpret_cast<uint32_t*>(&state);
+    return halves + (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ ? 1 : 0);
+}
+
+uint32_t EventCount::prepare_wait() {
+    uint64_t prev = state.fetch_add(1, std::memory_order_relaxed);
+    // Pairs with the fence in notify(): either the notifier sees this
+    // waiter, or the caller's re-check sees the notifier's change
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch_of(prev);
+}
+
+bool EventCount::cancel_wait(uint32_t key) {
+    // Once a notify has moved the epoch on it has already taken this
+    // waiter (or another) off the count; taking it off again could hide a sleeper
+    uint64_t current = state.load(std::memory_order_relaxed);
+    while (epoch_of(current) == key && (current & WAITER_MASK) != 0) {
+        if (state.compare_exchange_weak(current, current - 1, std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void EventCount::wait(uint32_t key) {
+    // The kernel re-checks the epoch atomically, so a bump after the load
+    // below makes the futex call return at once; the loop absorbs spurious wakeups
+    while (epoch_of(state.load(std::memory_order_acquire)) == key) {
+        syscall(SYS_futex, epoch_word(), FUTEX_WAIT_PRIVATE, key, nullptr, nullptr, 0);
+    }
+}
+
+bool EventCount::wait_for(uint32_t key, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (epoch_of(state.load(std::memory_order_acquire)) == key) {
+        auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            return false;
+        }
+        // FUTEX_WAIT measures a relative timeout on the monotonic clock
+        struct timespec ts;
+        ts.tv_sec = static_cast<time_t>(left.count() / 1000000000);
+        ts.tv_nsec = static_cast<long>(left.count() % 1000000000);
+        syscall(SYS_futex, epoch_word(), FUTEX_WAIT_PRIVATE, key, &ts, nullptr, 0);
+    }
+    return true;
+}
+
+void EventCount::notify(uint32_t count) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t current = state.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        uint64_t waiting = current & WAITER_MASK;
+        if (waiting == 0) {
+            return;
+        }
+        uint64_t epoch = static_cast<uint64_t>(epoch_of(current) + 1) << EPOCH_SHIFT;
+        next = epoch | (waiting > count ? waiting - count : 0);
+    } while (!state.compare_exchange_weak(current, next, std::memory_order_release, std::memory_order_relaxed));
+    int wake = count > static_cast<uint32_t>(INT_MAX) ? INT_MAX : static_cast<int>(count);
+    syscall(SYS_futex, epoch_word(), FUTEX_WAKE_PRIVATE, wake, nullptr, nullptr, 0);
+}
@@ -0,0 +1,55 @@
+#ifndef EVENT_COUNT_H
+#define EVENT_COUNT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Event count: lets threads sleep until "something changed" without a
+ * lock around the condition they wait on
+ * A waiter registers with prepare_wait(), re-checks its condition, then
+ * either cancel_wait()s or wait()s with the returned key. A notifier makes
+ * its change visible and then notifies, which costs a fence and
+ * one load when nobody is registered. A notify takes waiters off the count
+ * as it wakes them, so a burst of notifies wakes each sleeper once rather
+ * than making a syscall apiece. Sleeping is a futex on the epoch half of
+ * the state, so a notify between prepare_wait() and wait() is never lost.
+ */
+class EventCount {
+private:
+    // Epoch in the high half, bumped by every notify that finds a waiter;
+    // registered waiters not yet notified in the low half
+    std::atomic<uint64_t> state;
+
+    // Private helper methods
+    uint32_t* epoch_word();
+
+public:
+    EventCount() : state(0) {}
+
+    // Delete copy constructor and assignment operator
+    EventCount(const EventCount&) = delete;
+    EventCount& operator=(const EventCount&) = delete;
+
+    // Register as a waiter; re-check the condition after this
+    uint32_t prepare_wait();
+
+    // The condition held after all: unregister without sleeping. False if a
+    // notify already took this waiter, which then owes the notifier a look
+    bool cancel_wait(uint32_t key);
+
+    // Sleep until a notify after prepare_wait() returned key
+    void wait(uint32_t key);
+
+    // As wait(), but give up after timeout; on false the caller is still
+    // registered and must cancel_wait()
+    bool wait_for(uint32_t key, std::chrono::milliseconds timeout);
+
+    // Wake up to count waiters with one syscall
+    void notify(uint32_t count);
+    void notify_one() { notify(1); }
+    void notify_all() { notify(UINT32_MAX); }
+};
+
+#endif
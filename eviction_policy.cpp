@@ -0,0 +1,382 @@
+#include "eviction_policy.h"
+#include <algorithm>
+#include <stdexcept>
+
+void EntryList::push_front(CacheEntry* entry) {
+    entry->policy_prev = nullptr;
+    entry->policy_next = head;
+    if (head) {
+        head->policy_prev = entry;
+    }
+    head = entry;
+    if (!tail) {
+        tail = entry;
+    }
+    count++;
+}
+
+void EntryList::unlink(CacheEntry* entry) {
+    if (entry->policy_prev) {
+        entry->policy_prev->policy_next = entry->policy_next;
+    } else {
+        head = entry->policy_next;
+    }
+    if (entry->policy_next) {
+        entry->policy_next->policy_prev = entry->policy_prev;
+    } else {
+        tail = entry->policy_prev;
+    }
+    entry->policy_prev = nullptr;
+    entry->policy_next = nullptr;
+    count--;
+}
+
+void EntryList::move_to_front(CacheEntry* entry) {
+    if (head != entry) {
+        unlink(entry);
+        push_front(entry);
+    }
+}
+
+CacheEntry* LruPolicy::evict(uint64_t) {
+    CacheEntry* victim = recency.back();
+    recency.unlink(victim);
+    return victim;
+}
+
+void LruPolicy::on_insert(CacheEntry* entry) {
+    recency.push_front(entry);
+}
+
+void LruPolicy::on_access(CacheEntry* entry) {
+    recency.move_to_front(entry);
+}
+
+CacheEntry* ClockPolicy::evict(uint64_t) {
+    while (true) {
+        CacheEntry* candidate = ring.back();
+        if (candidate->policy_state == 0) {
+            ring.unlink(candidate);
+            return candidate;
+        }
+        // Referenced since the hand last passed: clear the bit and move on
+        candidate->policy_state = 0;
+        ring.move_to_front(candidate);
+    }
+}
+
+void ClockPolicy::on_insert(CacheEntry* entry) {
+    entry->policy_state = 0;
+    ring.push_front(entry);
+}
+
+void ClockPolicy::on_access(CacheEntry* entry) {
+    entry->policy_state = 1;
+}
+
+ArcPolicy::ArcPolicy(size_t cap)
+    : capacity(cap), target_t1(0), pending_hash(0), pending_ghost(NONE), has_pending(false) {}
+
+ArcPolicy::Ghost ArcPolicy::take_ghost(uint64_t hash) {
+    auto it = ghosts.find(hash);
+    if (it == ghosts.end()) {
+        return NONE;
+    }
+
+    // A ghost hit says the list it was evicted from deserved more room
+    Ghost list = it->second.list;
+    if (list == B1) {
+        size_t delta = std::max<size_t>(1, b2.size() / b1.size());
+        target_t1 = std::min(capacity, target_t1 + delta);
+        b1.erase(it->second.position);
+    } else {
+        size_t delta = std::max<size_t>(1, b1.size() / b2.size());
+        target_t1 = target_t1 > delta ? target_t1 - delta : 0;
+        b2.erase(it->second.position);
+    }
+    ghosts.erase(it);
+    return list;
+}
+
+void ArcPolicy::add_ghost(Ghost list, uint64_t hash) {
+    std::list<uint64_t>& ghost_list = (list == B1) ? b1 : b2;
+    ghost_list.push_front(hash);
+    ghosts[hash] = {list, ghost_list.begin()};
+}
+
+void ArcPolicy::drop_oldest_ghost(Ghost list) {
+    std::list<uint64_t>& ghost_list = (list == B1) ? b1 : b2;
+    if (!ghost_list.empty()) {
+        ghosts.erase(ghost_list.back());
+        ghost_list.pop_back();
+    }
+}
+
+CacheEntry* ArcPolicy::replace(bool incoming_in_b2) {
+    CacheEntry* victim;
+    if (!t1.empty() && (t1.size() > target_t1 || (incoming_in_b2 && t1.size() == target_t1) || t2.empty())) {
+        victim = t1.back();
+        t1.unlink(victim);
+        add_ghost(B1, victim->hash);
+    } else {
+        victim = t2.back();
+        t2.unlink(victim);
+        add_ghost(B2, victim->hash);
+    }
+    return victim;
+}
+
+CacheEntry* ArcPolicy::evict(uint64_t incoming_hash) {
+    // A byte-budget shard may evict several times for one insert
+    Ghost hit = (has_pending && pending_hash == incoming_hash) ? pending_ghost : take_ghost(incoming_hash);
+    pending_hash = incoming_hash;
+    pending_ghost = hit;
+    has_pending = true;
+
+    if (hit == NONE) {
+        // Keep T1 + B1 within the capacity and all four lists within twice it
+        if (t1.size() + b1.size() >= capacity) {
+            if (t1.size() < capacity) {
+                drop_oldest_ghost(B1);
+                return replace(false);
+            }
+            CacheEntry* victim = t1.back();
+            t1.unlink(victim);
+            return victim;
+        }
+        if (t1.size() + t2.size() + b1.size() + b2.size() >= 2 * capacity) {
+            drop_oldest_ghost(B2);
+        }
+    }
+    return replace(hit == B2);
+}
+
+void ArcPolicy::on_insert(CacheEntry* entry) {
+    Ghost hit = (has_pending && pending_hash == entry->hash) ? pending_ghost : take_ghost(entry->hash);
+    has_pending = false;
+
+    // Seen before (as a ghost) counts as the second access
+    if (hit != NONE) {
+        entry->policy_state = 1;
+        t2.push_front(entry);
+    } else {
+        entry->policy_state = 0;
+        t1.push_front(entry);
+    }
+}
+
+void ArcPolicy::on_access(CacheEntry* entry) {
+    if (entry->policy_state == 0) {
+        t1.unlink(entry);
+        entry->policy_state = 1;
+        t2.push_front(entry);
+    } else {
+        t2.move_to_front(entry);
+    }
+}
+
+void ArcPolicy::on_remove(CacheEntry* entry) {
+    // Not a replacement decision, so it leaves no ghost
+    (entry->policy_state == 0 ? t1 : t2).unlink(entry);
+}
+
+void ArcPolicy::clear() {
+    t1.clear();
+    t2.clear();
+    b1.clear();
+    b2.clear();
+    ghosts.clear();
+    target_t1 = 0;
+    has_pending = false;
+}
+
+CountMinSketch::CountMinSketch(size_t capacity) : row_mask(15), additions(0) {
+    while (row_mask + 1 < capacity) {
+        row_mask = (row_mask << 1) | 1;
+    }
+    table.assign(CACHE_SKETCH_DEPTH * ((row_mask + 1) / 16), 0);
+    sample_size = 10 * (row_mask + 1);
+}
+
+size_t CountMinSketch::index_of(uint64_t hash, int row) const {
+    static const uint64_t seeds[] = {0xC3A5C85C97CB3127ULL, 0xB492B66FBE98F273ULL,
+                                     0x9AE16A3B2F90404FULL, 0xCBF29CE484222325ULL};
+    uint64_t mixed = (hash ^ seeds[row % 4]) * 0x9E3779B97F4A7C15ULL;
+    mixed ^= mixed >> 32;
+    return static_cast<size_t>(mixed) & row_mask;
+}
+
+void CountMinSketch::increment(uint64_t hash) {
+    size_t words_per_row = (row_mask + 1) / 16;
+    bool added = false;
+
+    for (int row = 0; row < CACHE_SKETCH_DEPTH; ++row) {
+        size_t index = index_of(hash, row);
+        uint64_t& word = table[row * words_per_row + index / 16];
+        int shift = static_cast<int>(index % 16) * 4;
+        if (((word >> shift) & 0xF) < 15) {
+            word += uint64_t(1) << shift;
+            added = true;
+        }
+    }
+
+    if (added && ++additions >= sample_size) {
+        halve();
+    }
+}
+
+int CountMinSketch::estimate(uint64_t hash) const {
+    size_t words_per_row = (row_mask + 1) / 16;
+    int frequency = 15;
+
+    for (int row = 0; row < CACHE_SKETCH_DEPTH; ++row) {
+        size_t index = index_of(hash, row);
+        uint64_t word = table[row * words_per_row + index / 16];
+        int shift = static_cast<int>(index % 16) * 4;
+        frequency = std::min(frequency, static_cast<int>((word >> shift) & 0xF));
+    }
+    return frequency;
+}
+
+void CountMinSketch::halve() {
+    for (uint64_t& word : table) {
+        word = (word >> 1) & 0x7777777777777777ULL;
+    }
+    additions /= 2;
+}
+
+void CountMinSketch::clear() {
+    std::fill(table.begin(), table.end(), 0);
+    additions = 0;
+}
+
+TinyLfuPolicy::TinyLfuPolicy(size_t capacity)
+    : window_capacity(std::max<size_t>(1, capacity * CACHE_TINYLFU_WINDOW_PERCENT / 100)),
+      main_capacity(capacity > window_capacity ? capacity - window_capacity : 0),
+      protected_capacity(main_capacity * CACHE_TINYLFU_PROTECTED_PERCENT / 100),
+      sketch(capacity) {}
+
+CacheEntry* TinyLfuPolicy::main_victim() const {
+    return probation.empty() ? protected_list.back() : probation.back();
+}
+
+CacheEntry* TinyLfuPolicy::evict(uint64_t) {
+    // A byte-budget shard may evict again after draining the window
+    if (window.empty()) {
+        CacheEntry* victim = main_victim();
+        (victim->policy_state == PROBATION ? probation : protected_list).unlink(victim);
+        return victim;
+    }
+
+    // Full means both areas are full; the incoming entry will push the
+    // window's oldest out, so it competes with the main area's victim
+    CacheEntry* candidate = window.back();
+    window.unlink(candidate);
+    if (main_capacity == 0 || (probation.empty() && protected_list.empty())) {
+        return candidate;
+    }
+
+    CacheEntry* victim = main_victim();
+    if (sketch.estimate(candidate->hash) <= sketch.estimate(victim->hash)) {
+        return candidate;
+    }
+
+    if (victim->policy_state == PROBATION) {
+        probation.unlink(victim);
+    } else {
+        protected_list.unlink(victim);
+    }
+    candidate->policy_state = PROBATION;
+    probation.push_front(candidate);
+    return victim;
+}
+
+void TinyLfuPolicy::on_insert(CacheEntry* entry) {
+    sketch.increment(entry->hash);
+    entry->policy_state = WINDOW;
+    window.push_front(entry);
+
+    // While the cache fills up, window overflow moves straight to the main area
+    if (window.size() > window_capacity && probation.size() + protected_list.size() < main_capacity) {
+        CacheEntry* demoted = window.back();
+        window.unlink(demoted);
+        demoted->policy_state = PROBATION;
+        probation.push_front(demoted);
+    }
+}
+
+void TinyLfuPolicy::on_access(CacheEntry* entry) {
+    sketch.increment(entry->hash);
+
+    switch (entry->policy_state) {
+        case WINDOW:
+            window.move_to_front(entry);
+            break;
+
+        case PROBATION:
+            probation.unlink(entry);
+            entry->policy_state = PROTECTED;
+            protected_list.push_front(entry);
+            if (protected_list.size() > protected_capacity) {
+                CacheEntry* demoted = protected_list.back();
+                protected_list.unlink(demoted);
+                demoted->policy_state = PROBATION;
+                probation.push_front(demoted);
+            }
+            break;
+
+        default:
+            protected_list.move_to_front(entry);
+            break;
+    }
+}
+
+void TinyLfuPolicy::on_remove(CacheEntry* entry) {
+    switch (entry->policy_state) {
+        case WINDOW:
+            window.unlink(entry);
+            break;
+        case PROBATION:
+            probation.unlink(entry);
+            break;
+        default:
+            protected_list.unlink(entry);
+            break;
+    }
+}
+
+void TinyLfuPolicy::clear() {
+    window.clear();
+    probation.clear();
+    protected_list.clear();
+    sketch.clear();
+}
+
+std::unique_ptr<EvictionPolicy> make_eviction_policy(EvictionPolicyType type, size_t capacity) {
+    switch (type) {
+        case EvictionPolicyType::LRU:
+            return std::make_unique<LruPolicy>();
+        case EvictionPolicyType::CLOCK:
+            return std::make_unique<ClockPolicy>();
+        case EvictionPolicyType::ARC:
+            return std::make_unique<ArcPolicy>(capacity);
+        case EvictionPolicyType::TINY_LFU:
+            return std::make_unique<TinyLfuPolicy>(capacity);
+    }
+    throw std::invalid_argument("Unknown eviction policy");
+}
+
+bool parse_eviction_policy(const std::string& name, EvictionPolicyType& type) {
+    if (name == "lru") {
+        type = EvictionPolicyType::LRU;
+    } else if (name == "clock") {
+        type = EvictionPolicyType::CLOCK;
+    } else if (name == "arc") {
+        type = EvictionPolicyType::ARC;
+    } else if (name == "tinylfu") {
+        type = EvictionPolicyType::TINY_LFU;
+    } else {
+        return false;
+    }
+    return true;
+}
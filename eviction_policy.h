@@ -0,0 +1,207 @@
+#ifndef EVICTION_POLICY_H
+#define EVICTION_POLICY_H
+
+#include "common.h"
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class EvictionPolicyType : uint8_t {
+    LRU,
+    CLOCK,
+    ARC,
+    TINY_LFU  // W-TinyLFU: LRU window, segmented LRU main area, count-min admission
+};
+
+// Intrusive doubly linked list over CacheEntry::policy_prev/policy_next
+class EntryList {
+private:
+    CacheEntry* head;
+    CacheEntry* tail;
+    size_t count;
+
+public:
+    EntryList() : head(nullptr), tail(nullptr), count(0) {}
+
+    void push_front(CacheEntry* entry);
+    void unlink(CacheEntry* entry);
+    void move_to_front(CacheEntry* entry);
+
+    CacheEntry* back() const { return tail; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() { head = tail = nullptr; count = 0; }
+};
+
+/**
+ * Eviction strategy for one cache (or cache shard)
+ * The cache owns the entries and calls in under its writer lock: evict()
+ * when it is full and about to insert (repeatedly, if entries are
+ * weighted), then on_insert() for the new entry, and on_remove() when an
+ * entry leaves for another reason (expiry).
+ * The policy only orders entries; it never frees them. Cache<> takes any
+ * class with these methods; the implementations below are final so it
+ * calls them directly.
+ */
+class EvictionPolicy {
+public:
+    virtual ~EvictionPolicy() = default;
+
+    virtual const char* name() const = 0;
+
+    // Unlink and return the entry to drop so incoming_hash can be added
+    virtual CacheEntry* evict(uint64_t incoming_hash) = 0;
+    virtual void on_insert(CacheEntry* entry) = 0;
+    virtual void on_access(CacheEntry* entry) = 0;
+    // Unlink an entry the cache is dropping without asking for a victim
+    virtual void on_remove(CacheEntry* entry) = 0;
+
+    // Forget every entry; the cache frees them
+    virtual void clear() = 0;
+};
+
+// Least recently used
+class LruPolicy final : public EvictionPolicy {
+private:
+    EntryList recency;
+
+public:
+    const char* name() const override { return "LRU"; }
+    CacheEntry* evict(uint64_t incoming_hash) override;
+    void on_insert(CacheEntry* entry) override;
+    void on_access(CacheEntry* entry) override;
+    void on_remove(CacheEntry* entry) override { recency.unlink(entry); }
+    void clear() override { recency.clear(); }
+};
+
+// Second-chance FIFO: an access only sets a reference bit, and the hand
+// skips (and clears) referenced entries once
+class ClockPolicy final : public EvictionPolicy {
+private:
+    EntryList ring;  // Hand at the back
+
+public:
+    const char* name() const override { return "CLOCK"; }
+    CacheEntry* evict(uint64_t incoming_hash) override;
+    void on_insert(CacheEntry* entry) override;
+    void on_access(CacheEntry* entry) override;
+    void on_remove(CacheEntry* entry) override { ring.unlink(entry); }
+    void clear() override { ring.clear(); }
+};
+
+// Adaptive Replacement Cache (Megiddo & Modha): balances a recency list T1
+// against a frequency list T2, steered by ghost lists of recent victims
+class ArcPolicy final : public EvictionPolicy {
+private:
+    enum Ghost : uint8_t { NONE, B1, B2 };
+
+    struct GhostEntry {
+        Ghost list;
+        std::list<uint64_t>::iterator position;
+    };
+
+    size_t capacity;
+    size_t target_t1;  // ARC's p
+    EntryList t1;
+    EntryList t2;
+    std::list<uint64_t> b1;  // Most recent ghost at the front
+    std::list<uint64_t> b2;
+    std::unordered_map<uint64_t, GhostEntry> ghosts;
+
+    // evict() consumes the incoming key's ghost; on_insert() needs the result
+    uint64_t pending_hash;
+    Ghost pending_ghost;
+    bool has_pending;
+
+    // Private helper methods
+    Ghost take_ghost(uint64_t hash);
+    void add_ghost(Ghost list, uint64_t hash);
+    void drop_oldest_ghost(Ghost list);
+    CacheEntry* replace(bool incoming_in_b2);
+
+public:
+    explicit ArcPolicy(size_t capacity);
+
+    const char* name() const override { return "ARC"; }
+    CacheEntry* evict(uint64_t incoming_hash) override;
+    void on_insert(CacheEntry* entry) override;
+    void on_access(CacheEntry* entry) override;
+    void on_remove(CacheEntry* entry) override;
+    void clear() override;
+};
+
+// Frequency estimates with 4-bit counters, halved periodically so old
+// popularity fades
+class CountMinSketch {
+private:
+    std::vector<uint64_t> table;  // CACHE_SKETCH_DEPTH rows of 16 counters per word
+    size_t row_mask;              // Counters per row - 1
+    uint64_t additions;
+    uint64_t sample_size;
+
+    // Private helper methods
+    size_t index_of(uint64_t hash, int row) const;
+    void halve();
+
+public:
+    explicit CountMinSketch(size_t capacity);
+
+    void increment(uint64_t hash);
+    int estimate(uint64_t hash) const;
+    void clear();
+};
+
+// W-TinyLFU (Einziger, Friedman & Manes): new entries wait in a small LRU
+// window; a window victim only displaces a main-area victim if the sketch
+// says it is used more often, so one-off bursts cannot flush hot entries
+class TinyLfuPolicy final : public EvictionPolicy {
+private:
+    enum Segment : uint8_t { WINDOW, PROBATION, PROTECTED };
+
+    size_t window_capacity;
+    size_t main_capacity;
+    size_t protected_capacity;
+    EntryList window;
+    EntryList probation;
+    EntryList protected_list;
+    CountMinSketch sketch;
+
+    // Private helper methods
+    CacheEntry* main_victim() const;
+
+public:
+    explicit TinyLfuPolicy(size_t capacity);
+
+    const char* name() const override { return "W-TinyLFU"; }
+    CacheEntry* evict(uint64_t incoming_hash) override;
+    void on_insert(CacheEntry* entry) override;
+    void on_access(CacheEntry* entry) override;
+    void on_remove(CacheEntry* entry) override;
+    void clear() override;
+};
+
+std::unique_ptr<EvictionPolicy> make_eviction_policy(EvictionPolicyType type, size_t capacity);
+
+// Policy chosen at run time (--cache-policy), for Cache<> instantiations;
+// calls go through EvictionPolicy's vtable
+class DynamicEviction {
+private:
+    std::unique_ptr<EvictionPolicy> policy;
+
+public:
+    DynamicEviction(EvictionPolicyType type, size_t capacity) : policy(make_eviction_policy(type, capacity)) {}
+
+    const char* name() const { return policy->name(); }
+    CacheEntry* evict(uint64_t incoming_hash) { return policy->evict(incoming_hash); }
+    void on_insert(CacheEntry* entry) { policy->on_insert(entry); }
+    void on_access(CacheEntry* entry) { policy->on_access(entry); }
+    void on_remove(CacheEntry* entry) { policy->on_remove(entry); }
+    void clear() { policy->clear(); }
+};
+
+// Parse a --cache-policy value
+bool parse_eviction_policy(const std::string& name, EvictionPolicyType& type);
+
+#endif
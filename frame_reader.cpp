@@ -0,0 +1,112 @@
+#include "frame_reader.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+FrameReader::FrameReader(uint8_t version, size_t capacity)
+    : buffer(capacity), head(0), count(0), protocol_version(version), scratch(MAX_FRAME_SIZE) {
+    if (capacity < MAX_FRAME_SIZE) {
+        throw std::invalid_argument("Frame reader capacity must hold at least one frame");
+    }
+}
+
+ssize_t FrameReader::fill(int socket_fd, int flags) {
+    size_t cap = buffer.size();
+    if (count == cap) {
+        errno = ENOBUFS;
+        return -1;
+    }
+    
+    // Free space is at most two segments: tail..end and start..head
+    size_t tail = (head + count) % cap;
+    struct iovec iov[2];
+    int iov_count = 1;
+    iov[0].iov_base = buffer.data() + tail;
+    iov[0].iov_len = (tail >= head) ? cap - tail : head - tail;
+    if (tail >= head && head > 0) {
+        iov[1].iov_base = buffer.data();
+        iov[1].iov_len = head;
+        iov_count = 2;
+    }
+    
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = iov;
+    mh.msg_iovlen = iov_count;
+    
+    ssize_t bytes = recvmsg(socket_fd, &mh, flags);
+    if (bytes > 0) {
+        count += static_cast<size_t>(bytes);
+    }
+    return bytes;
+}
+
+bool FrameReader::append(const char* data, size_t length) {
+    size_t cap = buffer.size();
+    if (length > cap - count) {
+        return false;
+    }
+    
+    size_t tail = (head + count) % cap;
+    size_t first = std::min(length, cap - tail);
+    memcpy(buffer.data() + tail, data, first);
+    memcpy(buffer.data(), data + first, length - first);
+    count += length;
+    return true;
+}
+
+const char* FrameReader::front(size_t& available) {
+    size_t cap = buffer.size();
+    const char* data = buffer.data() + head;
+    available = std::min(count, cap - head);
+    
+    // Only copy when the buffered bytes wrap and the front segment may hold a partial frame
+    if (available < count && available < MAX_FRAME_SIZE) {
+        size_t wanted = std::min(count, MAX_FRAME_SIZE);
+        memcpy(scratch.data(), data, available);
+        memcpy(scratch.data() + available, buffer.data(), wanted - available);
+        data = scratch.data();
+        available = wanted;
+    }
+    return data;
+}
+
+void FrameReader::consume(size_t length) {
+    head = (head + length) % buffer.size();
+    count -= length;
+    if (count == 0) {
+        head = 0;
+    }
+}
+
+DecodeStatus FrameReader::hello(std::string& user_id, uint8_t& version, bool input_idle) {
+    size_t available = 0;
+    const char* data = front(available);
+    
+    size_t consumed = 0;
+    DecodeStatus status = parse_hello(data, available, input_idle, user_id, version, consumed);
+    if (status == DecodeStatus::COMPLETE) {
+        consume(consumed);
+        protocol_version = version;
+    }
+    return status;
+}
+
+DecodeStatus FrameReader::next(Message& msg) {
+    if (count == 0) {
+        return DecodeStatus::INCOMPLETE;
+    }
+    
+    size_t available = 0;
+    const char* data = front(available);
+    
+    size_t consumed = 0;
+    DecodeStatus status = decode_message(data, available, protocol_version, msg, consumed);
+    if (status == DecodeStatus::COMPLETE) {
+        consume(consumed);
+    }
+    return status;
+}
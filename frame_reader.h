@@ -0,0 +1,52 @@
+#ifndef FRAME_READER_H
+#define FRAME_READER_H
+
+#include "common.h"
+#include "protocol.h"
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+/**
+ * Incremental per-connection frame parser over a ring buffer
+ * Each fill() pulls everything the socket has (up to the free space) in a
+ * single recvmsg, next() then pops complete messages one at a time and any
+ * partial tail stays buffered for the next read. Works for both the legacy
+ * fixed-size format and the framed protocol, and for the hello before them.
+ */
+class FrameReader {
+private:
+    std::vector<char> buffer;
+    size_t head;   // Offset of the first unread byte
+    size_t count;  // Bytes currently buffered
+    uint8_t protocol_version;
+    std::vector<char> scratch;  // Linearizes a frame that wraps past the end
+    
+    // Private helper methods
+    const char* front(size_t& available);
+    void consume(size_t length);
+
+public:
+    explicit FrameReader(uint8_t version = PROTOCOL_LEGACY, size_t capacity = FRAME_READER_CAPACITY);
+
+    // Read from a socket into the free space; same return convention as recv
+    ssize_t fill(int socket_fd, int flags = 0);
+
+    // Copy already-received bytes in; false if they do not fit
+    bool append(const char* data, size_t length);
+
+    // Decode the client hello at the front of the stream and switch to the
+    // protocol it asks for; input_idle as for parse_hello. Bytes after it
+    // stay buffered for next()
+    DecodeStatus hello(std::string& user_id, uint8_t& version, bool input_idle);
+    
+    // Decode the next complete message, if there is one
+    DecodeStatus next(Message& msg);
+
+    void set_protocol(uint8_t version) { protocol_version = version; }
+    uint8_t get_protocol() const { return protocol_version; }
+    size_t buffered() const { return count; }
+    size_t capacity() const { return buffer.size(); }
+};
+
+#endif
@@ -0,0 +1,513 @@
+#ifndef GENERIC_CACHE_H
+#define GENERIC_CACHE_H
+
+#include "bloom_filter.h"
+#include "common.h"
+#include "epoch.h"
+#include "eviction_policy.h"
+#include "timer_wheel.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Locking policy for a cache only one thread uses: no lock, no epoch guards,
+// and removed entries are freed on the spot
+struct NullLock {
+    void lock() {}
+    void unlock() {}
+};
+
+enum class VisitResult : uint8_t {
+    HIT,      // The key is cached
+    MISS,     // Not in the index
+    FILTERED  // The negative filter ruled it out without probing the index
+};
+
+// A cached key and value behind the bookkeeping the policy and timer wheel link through
+template <typename Key, typename Value>
+struct CacheNode : CacheEntry {
+    Key key;
+    Value value;
+
+    template <typename KeyArgs, typename ValueArgs>
+    CacheNode(std::piecewise_construct_t, KeyArgs&& key_args, ValueArgs&& value_args)
+        : key(std::make_from_tuple<Key>(std::forward<KeyArgs>(key_args))),
+          value(std::make_from_tuple<Value>(std::forward<ValueArgs>(value_args))) {}
+};
+
+/**
+ * Bounded cache with key, value, hash, eviction, locking and allocation
+ * chosen at compile time
+ * Lookups take no lock. They probe an open-addressed index under an epoch
+ * guard and validate a miss against a version counter bumped while writers
+ * move entries. Writers serialise on Lock and retire removed entries until
+ * no reader can hold them. With NullLock none of that is compiled in.
+ *
+ * Eviction is any class with EvictionPolicy's methods; it is built from the
+ * capacity if it takes one. Every entry has a weight, and with max_weight
+ * set the policy also evicts until the new entry's weight fits, alongside
+ * any weight the caller says is held outside the cache. Entries
+ * inserted with a TTL are dropped by the first expire() after their deadline.
+ *
+ * An optional counting Bloom filter over the cached keys answers most
+ * lookups of absent keys from one cache line, without probing the index.
+ *
+ * Keys and values are immutable once inserted. Lookups accept any probe
+ * that Hash hashes like the key and KeyEqual compares with it.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<>,
+          typename Eviction = LruPolicy, typename Lock = std::mutex, typename Allocator = std::allocator<Value>>
+class Cache {
+public:
+    using Node = CacheNode<Key, Value>;
+
+    static constexpr bool concurrent = !std::is_same<Lock, NullLock>::value;
+
+private:
+    using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+    using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+    // Destroys a node and hands its memory back to the allocator
+    struct NodeDeleter {
+        NodeAllocator allocator;
+
+        void operator()(Node* node) {
+            NodeTraits::destroy(allocator, node);
+            NodeTraits::deallocate(allocator, node, 1);
+        }
+    };
+
+    struct NoGuard {};
+    using ReadGuard = std::conditional_t<concurrent, Epoch::Guard, NoGuard>;
+
+    // A single thread needs no ordering between index and node
+    static constexpr std::memory_order publish = concurrent ? std::memory_order_release : std::memory_order_relaxed;
+    static constexpr std::memory_order observe = concurrent ? std::memory_order_acquire : std::memory_order_relaxed;
+
+    // Linear-probing index, at most half full, read by lock-free lookups
+    std::unique_ptr<std::atomic<Node*>[]> table;
+    size_t mask;
+    int table_bits;
+    std::atomic<uint64_t> version;  // Odd while entries are being moved or removed
+    std::unique_ptr<CountingBloomFilter> filter;  // Null unless enable_negative_filter() ran
+
+    // Writer state, guarded by lock
+    mutable Lock lock;
+    size_t capacity;
+    size_t size;
+    size_t max_weight;  // 0 if only the entry count is bounded
+    size_t weight;
+    Eviction policy;
+    TimerWheel timers;  // Entries with an expiry time
+    uint64_t expired;
+    Hash hasher;
+    KeyEqual equal;
+
+    // Declared before retired, whose deleter frees into it
+    NodeAllocator allocator;
+    RetireList<Node, NodeDeleter> retired;
+
+    // Private helper methods
+    static Eviction make_policy(size_t cap) {
+        if constexpr (std::is_constructible<Eviction, size_t>::value) {
+            return Eviction(cap);
+        } else {
+            return Eviction();
+        }
+    }
+
+    template <typename Probe>
+    uint64_t hash_of(const Probe& key) const {
+        return static_cast<uint64_t>(hasher(key));
+    }
+
+    size_t home(uint64_t hash) const {
+        // Callers that shard by the low hash bits still spread over the table
+        return static_cast<size_t>((hash * 0x9E3779B97F4A7C15ULL) >> (64 - table_bits));
+    }
+
+    template <typename Probe>
+    Node* probe(uint64_t hash, const Probe& key) const {
+        for (size_t i = home(hash);; i = (i + 1) & mask) {
+            Node* node = table[i].load(observe);
+            if (!node) {
+                return nullptr;
+            }
+            if (node->hash == hash && equal(node->key, key)) {
+                return node;
+            }
+        }
+    }
+
+    template <typename Probe>
+    Node* find_optimistic(uint64_t hash, const Probe& key) const {
+        if constexpr (!concurrent) {
+            return probe(hash, key);
+        }
+        while (true) {
+            uint64_t before = version.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                // A hit is always genuine: nodes are immutable and pinned by the epoch
+                Node* node = probe(hash, key);
+                if (node) {
+                    return node;
+                }
+                // A miss only counts if no node was shifted under the probe
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (version.load(std::memory_order_relaxed) == before) {
+                    return nullptr;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    void begin_write() {
+        if constexpr (concurrent) {
+            version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+    }
+
+    void end_write() {
+        if constexpr (concurrent) {
+            version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+    }
+
+    void index(Node* node) {
+        size_t i = home(node->hash);
+        while (table[i].load(std::memory_order_relaxed)) {
+            i = (i + 1) & mask;
+        }
+        // Release publishes the node's fields to readers that find it
+        table[i].store(node, publish);
+    }
+
+    void unindex(Node* node) {
+        size_t hole = home(node->hash);
+        while (table[hole].load(std::memory_order_relaxed) != node) {
+            hole = (hole + 1) & mask;
+        }
+
+        begin_write();
+        // Backward-shift deletion: pull later nodes of the run into the hole
+        // so probes never need tombstones
+        for (size_t i = (hole + 1) & mask;; i = (i + 1) & mask) {
+            Node* next = table[i].load(std::memory_order_relaxed);
+            if (!next) {
+                break;
+            }
+            size_t next_home = home(next->hash);
+            bool stays = (i > hole) ? (next_home > hole && next_home <= i)
+                                    : (next_home > hole || next_home <= i);
+            if (!stays) {
+                table[hole].store(next, publish);
+                hole = i;
+            }
+        }
+        table[hole].store(nullptr, publish);
+        end_write();
+    }
+
+    // Free now, or once no reader can hold it
+    void dispose(Node* node) {
+        if constexpr (concurrent) {
+            retired.retire(node);
+        } else {
+            NodeDeleter{allocator}(node);
+        }
+    }
+
+    void reclaim_if_due() {
+        if constexpr (concurrent) {
+            if (retired.size() >= CACHE_RECLAIM_BATCH) {
+                retired.reclaim();
+            }
+        }
+    }
+
+    // Unindex and dispose of a node the policy has already let go of
+    void drop(Node* node) {
+        timers.cancel(node);
+        unindex(node);
+        if (filter) {
+            // Only once readers can no longer find it through the index
+            filter->remove(node->hash);
+        }
+        weight -= node->weight;
+        size--;
+        dispose(node);
+    }
+
+    template <typename Probe, typename... KeyArgs, typename... ValueArgs>
+    bool emplace_locked(uint64_t hash, const Probe& key, std::tuple<KeyArgs...> key_args,
+                        std::tuple<ValueArgs...> value_args, size_t entry_weight, time_t ttl, size_t held_weight) {
+        // Check if already exists
+        if ((!filter || filter->may_contain(hash)) && probe(hash, key)) {
+            return false;
+        }
+        if (entry_weight > UINT32_MAX || (max_weight > 0 && entry_weight + held_weight > max_weight)) {
+            // Could never fit, even in an empty cache
+            return false;
+        }
+
+        // Cache full, let the policy pick victims
+        while (size == capacity || (max_weight > 0 && weight + held_weight + entry_weight > max_weight)) {
+            drop(static_cast<Node*>(policy.evict(hash)));
+        }
+
+        // Fill in the new node before it becomes visible
+        Node* node = NodeTraits::allocate(allocator, 1);
+        try {
+            NodeTraits::construct(allocator, node, std::piecewise_construct, std::move(key_args),
+                                  std::move(value_args));
+        } catch (...) {
+            NodeTraits::deallocate(allocator, node, 1);
+            throw;
+        }
+        node->hash = hash;
+        node->weight = static_cast<uint32_t>(entry_weight);
+        policy.on_insert(node);
+        if (filter) {
+            // Before the index, so a reader never finds it but is told it is absent
+            filter->add(hash);
+        }
+        index(node);
+        size++;
+        weight += entry_weight;
+        if (ttl > 0) {
+            node->expires_at = time(nullptr) + ttl;
+            timers.schedule(node);
+        }
+
+        reclaim_if_due();
+        return true;
+    }
+
+    template <typename Probe>
+    bool update_access_locked(uint64_t hash, const Probe& key) {
+        Node* node = probe(hash, key);
+        if (node) {
+            policy.on_access(node);
+        }
+        return node != nullptr;
+    }
+
+public:
+    // Writer operations for batch(), which already holds the lock
+    class Batch {
+    private:
+        Cache& cache;
+
+    public:
+        explicit Batch(Cache& owner) : cache(owner) {}
+
+        // held_weight is weight kept outside the cache, such as freed memory
+        // that cannot be reused yet, that max_weight must also cover
+        template <typename Probe, typename... KeyArgs, typename... ValueArgs>
+        bool emplace(const Probe& key, std::tuple<KeyArgs...> key_args, std::tuple<ValueArgs...> value_args,
+                     size_t entry_weight = 1, time_t ttl = 0, size_t held_weight = 0) {
+            return cache.emplace_locked(cache.hash_of(key), key, std::move(key_args), std::move(value_args),
+                                        entry_weight, ttl, held_weight);
+        }
+
+        template <typename Probe>
+        bool update_access(const Probe& key) {
+            return cache.update_access_locked(cache.hash_of(key), key);
+        }
+    };
+
+    // weight_limit 0 bounds only the number of entries
+    explicit Cache(size_t cap, size_t weight_limit = 0, const Allocator& alloc = Allocator())
+        : Cache(cap, weight_limit, make_policy(cap), alloc) {}
+
+    Cache(size_t cap, size_t weight_limit, Eviction eviction, const Allocator& alloc = Allocator())
+        : table_bits(1), version(0), capacity(cap), size(0), max_weight(weight_limit), weight(0),
+          policy(std::move(eviction)), timers(time(nullptr)), expired(0), allocator(alloc),
+          retired(NodeDeleter{allocator}) {
+        if (capacity == 0) {
+            throw std::invalid_argument("Cache capacity must be positive");
+        }
+        // Keep the index at most half full so probe runs stay short
+        while ((size_t(1) << table_bits) < capacity * 2) {
+            table_bits++;
+        }
+        mask = (size_t(1) << table_bits) - 1;
+        table.reset(new std::atomic<Node*>[mask + 1]);
+        for (size_t i = 0; i <= mask; ++i) {
+            table[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~Cache() {
+        // No readers are left; retired nodes are freed by the RetireList
+        NodeDeleter free_node{allocator};
+        for (size_t i = 0; i <= mask; ++i) {
+            Node* node = table[i].load(std::memory_order_relaxed);
+            if (node) {
+                free_node(node);
+            }
+        }
+    }
+
+    // Delete copy constructor and assignment operator
+    Cache(const Cache&) = delete;
+    Cache& operator=(const Cache&) = delete;
+
+    // Build the key and value from the argument tuples, unless key (a probe
+    // for the key they make) is cached or the entry could never fit.
+    // ttl in seconds from now; 0 never expires
+    template <typename Probe, typename... KeyArgs, typename... ValueArgs>
+    bool emplace(const Probe& key, std::tuple<KeyArgs...> key_args, std::tuple<ValueArgs...> value_args,
+                 size_t entry_weight = 1, time_t ttl = 0) {
+        uint64_t hash = hash_of(key);
+        std::lock_guard<Lock> guard(lock);
+        return emplace_locked(hash, key, std::move(key_args), std::move(value_args), entry_weight, ttl, 0);
+    }
+
+    bool insert(const Key& key, const Value& value, size_t entry_weight = 1, time_t ttl = 0) {
+        return emplace(key, std::forward_as_tuple(key), std::forward_as_tuple(value), entry_weight, ttl);
+    }
+
+    // Call fn(value) on a hit; the value may be evicted once fn returns, so
+    // copy out what must outlive the call. False on a miss
+    template <typename Probe, typename Fn>
+    bool visit(const Probe& key, Fn&& fn) const {
+        return try_visit(key, std::forward<Fn>(fn)) == VisitResult::HIT;
+    }
+
+    // As visit(), but a miss says whether the filter or the index answered it
+    template <typename Probe, typename Fn>
+    VisitResult try_visit(const Probe& key, Fn&& fn) const {
+        uint64_t hash = hash_of(key);
+        if (filter && !filter->may_contain(hash)) {
+            return VisitResult::FILTERED;
+        }
+        [[maybe_unused]] ReadGuard guard;
+        Node* node = find_optimistic(hash, key);
+        if (!node) {
+            return VisitResult::MISS;
+        }
+        fn(static_cast<const Value&>(node->value));
+        return VisitResult::HIT;
+    }
+
+    template <typename Probe>
+    bool lookup(const Probe& key, Value& value) const {
+        return visit(key, [&value](const Value& cached) { value = cached; });
+    }
+
+    // Tell the policy the entry was used; false if it is not cached
+    template <typename Probe>
+    bool update_access(const Probe& key) {
+        uint64_t hash = hash_of(key);
+        std::lock_guard<Lock> guard(lock);
+        return update_access_locked(hash, key);
+    }
+
+    // Run fn(batch) under one acquisition of the lock, for several writes
+    // that would otherwise each take it
+    template <typename Fn>
+    auto batch(Fn&& fn) {
+        std::lock_guard<Lock> guard(lock);
+        Batch writer(*this);
+        return fn(writer);
+    }
+
+    // Start loading the index slot a lookup or write of key begins at, so
+    // a batch can overlap the cache misses of all its keys
+    template <typename Probe>
+    void prefetch(const Probe& key) const {
+        __builtin_prefetch(&table[home(hash_of(key))]);
+    }
+
+    // Drop every entry whose TTL ran out by now; returns how many
+    size_t expire(time_t now) {
+        std::lock_guard<Lock> guard(lock);
+
+        std::vector<CacheEntry*> due;
+        timers.advance(now, due);
+        for (CacheEntry* entry : due) {
+            policy.on_remove(entry);
+            drop(static_cast<Node*>(entry));
+        }
+        expired += due.size();
+
+        reclaim_if_due();
+        return due.size();
+    }
+
+    void clear() {
+        std::lock_guard<Lock> guard(lock);
+
+        begin_write();
+        for (size_t i = 0; i <= mask; ++i) {
+            Node* node = table[i].exchange(nullptr, std::memory_order_acq_rel);
+            if (node) {
+                dispose(node);
+            }
+        }
+        end_write();
+        if (filter) {
+            filter->clear();
+        }
+
+        policy.clear();
+        timers.clear();
+        if constexpr (concurrent) {
+            retired.reclaim();
+        }
+
+        size = 0;
+        weight = 0;
+        expired = 0;
+    }
+
+    // Keep a negative filter over the cached keys; call before the cache is shared
+    void enable_negative_filter() {
+        std::lock_guard<Lock> guard(lock);
+        if (filter) {
+            return;
+        }
+        filter = std::make_unique<CountingBloomFilter>(capacity);
+        for (size_t i = 0; i <= mask; ++i) {
+            if (Node* node = table[i].load(std::memory_order_relaxed)) {
+                filter->add(node->hash);
+            }
+        }
+    }
+
+    // False if key is certainly not cached (always true without a filter)
+    template <typename Probe>
+    bool may_contain(const Probe& key) const {
+        return !filter || filter->may_contain(hash_of(key));
+    }
+
+    // Bytes the negative filter occupies, 0 without one
+    size_t get_filter_bytes() const { return filter ? filter->memory_bytes() : 0; }
+
+    // Run fn() under the writer lock, e.g. to read an allocator's state
+    template <typename Fn>
+    auto with_lock(Fn&& fn) const {
+        std::lock_guard<Lock> guard(lock);
+        return fn();
+    }
+
+    // Const getters
+    size_t get_size() const { return with_lock([this]() { return size; }); }
+    size_t get_weight() const { return with_lock([this]() { return weight; }); }
+    uint64_t get_expired() const { return with_lock([this]() { return expired; }); }
+    size_t get_capacity() const { return capacity; }
+    size_t get_max_weight() const { return max_weight; }
+    const Eviction& get_policy() const { return policy; }
+};
+
+#endif
@@ -0,0 +1,243 @@
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+// Holds a thread's ring and retires it when the thread exits
+struct RingHolder {
+    const Logger* owner = nullptr;
+    std::shared_ptr<LogRing> ring;
+
+    ~RingHolder() {
+        if (ring) {
+            ring->retired.store(true, std::memory_order_release);
+        }
+    }
+};
+
+thread_local RingHolder ring_holder;
+
+int64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void fill_record(LogRecord& record, LogLevel level, const std::string& message) {
+    record.timestamp_us = now_us();
+    record.level = level;
+    record.length = static_cast<uint16_t>(std::min(message.size(), sizeof(record.text)));
+    memcpy(record.text, message.data(), record.length);
+}
+
+}  // namespace
+
+Logger::Logger()
+    : min_level(LogLevel::INFO), sample_every(1), running(false), closing(false), dropped(0), reported_drops(0) {}
+
+Logger::~Logger() {
+    stop();
+    if (file.is_open()) {
+        file.close();
+    }
+}
+
+bool Logger::start(const std::string& path) {
+    if (running.load()) {
+        return true;
+    }
+
+    if (!file.is_open()) {
+        file.open(path, std::ios::app);
+    }
+    closing.store(false);
+    running.store(true);
+    writer = std::thread(&Logger::writer_loop, this);
+    return file.is_open();
+}
+
+void Logger::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+
+    // A producer that saw running before the exchange is still queueing;
+    // its record must be in the ring before the writer's last drain
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        for (const auto& ring : rings) {
+            while (ring->writing.load(std::memory_order_seq_cst)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    closing.store(true, std::memory_order_release);
+    wake.notify_one();
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+LogRing& Logger::local_ring() {
+    if (ring_holder.owner != this) {
+        auto ring = std::make_shared<LogRing>();
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex);
+            rings.push_back(ring);
+        }
+        if (ring_holder.ring) {
+            ring_holder.ring->retired.store(true, std::memory_order_release);
+        }
+        ring_holder.owner = this;
+        ring_holder.ring = std::move(ring);
+    }
+    return *ring_holder.ring;
+}
+
+bool Logger::sample() {
+    if (!enabled(LogLevel::INFO)) {
+        return false;
+    }
+    thread_local uint32_t counter = 0;
+    return counter++ % sample_every.load(std::memory_order_relaxed) == 0;
+}
+
+void Logger::log(LogLevel level, const std::string& message) {
+    if (!enabled(level)) {
+        return;
+    }
+
+    if (running.load(std::memory_order_acquire)) {
+        // Pairs with stop(): either the re-check sees running cleared, or
+        // stop() sees writing set and waits for the record
+        LogRing& ring = local_ring();
+        ring.writing.store(true, std::memory_order_seq_cst);
+        if (running.load(std::memory_order_seq_cst)) {
+            uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+            if (tail - ring.head.load(std::memory_order_acquire) >= LOG_RING_CAPACITY) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                fill_record(ring.records[tail % LOG_RING_CAPACITY], level, message);
+                ring.tail.store(tail + 1, std::memory_order_release);
+            }
+            ring.writing.store(false, std::memory_order_release);
+            return;
+        }
+        ring.writing.store(false, std::memory_order_release);
+    }
+
+    // No writer (startup, shutdown): format inline
+    std::vector<LogRecord> batch(1);
+    fill_record(batch[0], level, message);
+    std::string out;
+    write_batch(batch, out);
+}
+
+void Logger::drain(std::vector<LogRecord>& batch) {
+    std::lock_guard<std::mutex> lock(rings_mutex);
+
+    for (auto it = rings.begin(); it != rings.end();) {
+        LogRing& ring = **it;
+        // Read retired first: a ring seen retired has no more records coming
+        bool retired = ring.retired.load(std::memory_order_acquire);
+        uint64_t head = ring.head.load(std::memory_order_relaxed);
+        uint64_t tail = ring.tail.load(std::memory_order_acquire);
+
+        for (; head != tail; ++head) {
+            batch.push_back(ring.records[head % LOG_RING_CAPACITY]);
+        }
+        ring.head.store(head, std::memory_order_release);
+
+        if (retired) {
+            it = rings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void Logger::write_batch(std::vector<LogRecord>& batch, std::string& out) {
+    // Rings are drained one after another; restore time order across threads
+    std::stable_sort(batch.begin(), batch.end(), [](const LogRecord& a, const LogRecord& b) {
+        return a.timestamp_us < b.timestamp_us;
+    });
+
+    time_t cached_second = -1;
+    char timestamp[32] = {0};
+    out.clear();
+
+    for (const LogRecord& record : batch) {
+        // localtime_r and strftime once per second of log output, not per line
+        time_t second = static_cast<time_t>(record.timestamp_us / 1000000);
+        if (second != cached_second) {
+            struct tm tm_info;
+            localtime_r(&second, &tm_info);
+            strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &tm_info);
+            cached_second = second;
+        }
+        out.append(timestamp);
+        out.append(" - ");
+        out.append(record.text, record.length);
+        out.push_back('\n');
+    }
+
+    if (out.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(output_mutex);
+    std::cout << out << std::flush;
+    if (file.is_open()) {
+        file << out;
+        file.flush();
+    }
+}
+
+void Logger::writer_loop() {
+    std::vector<LogRecord> batch;
+    std::string out;
+
+    while (true) {
+        // Drain once more after stop() so nothing queued before it is lost
+        bool stopping = closing.load(std::memory_order_acquire);
+
+        batch.clear();
+        drain(batch);
+
+        uint64_t lost = dropped.load(std::memory_order_relaxed);
+        if (lost > reported_drops) {
+            LogRecord notice;
+            fill_record(notice, LogLevel::WARN, "[Logger] " + std::to_string(lost - reported_drops) +
+                                                " log records dropped (ring full)");
+            batch.push_back(notice);
+            reported_drops = lost;
+        }
+        write_batch(batch, out);
+
+        if (stopping) {
+            break;
+        }
+        if (batch.empty()) {
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MS));
+        }
+    }
+}
+
+bool parse_log_level(const std::string& name, LogLevel& level) {
+    if (name == "debug") {
+        level = LogLevel::DEBUG;
+    } else if (name == "info") {
+        level = LogLevel::INFO;
+    } else if (name == "warn") {
+        level = LogLevel::WARN;
+    } else if (name == "error") {
+        level = LogLevel::ERROR;
+    } else if (name == "off") {
+        level = LogLevel::OFF;
+    } else {
+        return false;
+    }
+    return true;
+}
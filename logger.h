@@ -0,0 +1,110 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "common.h"
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class LogLevel : uint8_t {
+    DEBUG,
+    INFO,
+    WARN,
+    ERROR,
+    OFF  // Only valid as a threshold
+};
+
+// One log line as written by a producer: no formatting has happened yet
+struct LogRecord {
+    int64_t timestamp_us;  // Wall clock, microseconds since the epoch
+    LogLevel level;
+    uint16_t length;
+    char text[LOG_RECORD_SIZE - sizeof(int64_t) - 2 * sizeof(uint16_t)];
+};
+
+static_assert(sizeof(LogRecord) == LOG_RECORD_SIZE, "LogRecord must stay fixed-size");
+
+// Single-producer, single-consumer ring of records owned by one thread
+struct LogRing {
+    alignas(64) std::atomic<uint64_t> head;  // Next record to read (writer thread)
+    alignas(64) std::atomic<uint64_t> tail;  // Next slot to fill (producer)
+    std::atomic<bool> retired;               // Producer thread has exited
+    std::atomic<bool> writing;               // Producer is between its running check and tail
+    LogRecord records[LOG_RING_CAPACITY];
+
+    LogRing() : head(0), tail(0), retired(false), writing(false) {}
+};
+
+/**
+ * Asynchronous logger
+ * Producers copy a timestamped record into their own lock-free ring and
+ * return; if the ring is full the record is dropped and counted rather than
+ * blocking the caller. A background thread collects the rings, orders each
+ * batch by time, formats it, and writes it to stdout and the log file with
+ * one flush per batch.
+ */
+class Logger {
+private:
+    std::atomic<LogLevel> min_level;
+    std::atomic<uint32_t> sample_every;
+    std::atomic<bool> running;
+    std::atomic<bool> closing;      // Set by stop() once no producer can still queue; writer's last drain
+    std::atomic<uint64_t> dropped;  // Records lost to full rings
+
+    std::vector<std::shared_ptr<LogRing>> rings;
+    std::mutex rings_mutex;  // Taken once per producer thread, and by the writer
+
+    std::thread writer;
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::ofstream file;
+    std::mutex output_mutex;  // Inline writes can overlap the writer's last batch
+    uint64_t reported_drops;  // Writer thread only
+
+    // Private helper methods
+    LogRing& local_ring();
+    void writer_loop();
+    void drain(std::vector<LogRecord>& batch);
+    void write_batch(std::vector<LogRecord>& batch, std::string& out);
+
+public:
+    Logger();
+    ~Logger();
+
+    // Delete copy constructor and assignment operator
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Start the writer thread; returns false if path could not be opened
+    // (logging then goes to stdout only)
+    bool start(const std::string& path);
+
+    // Write everything still queued and stop the writer thread; later lines
+    // are written inline. A line logged while it runs is written either way
+    void stop();
+
+    void set_level(LogLevel level) { min_level.store(level, std::memory_order_relaxed); }
+    void set_sample_every(uint32_t every) { sample_every.store(every ? every : 1, std::memory_order_relaxed); }
+
+    bool enabled(LogLevel level) const {
+        return level >= min_level.load(std::memory_order_relaxed) && level != LogLevel::OFF;
+    }
+
+    // True for one in every sample_every per-message lines on this thread;
+    // check it before building the line
+    bool sample();
+
+    void log(LogLevel level, const std::string& message);
+
+    uint64_t get_dropped() const { return dropped.load(std::memory_order_relaxed); }
+};
+
+// Parse a --log-level value
+bool parse_log_level(const std::string& name, LogLevel& level);
+
+#endif
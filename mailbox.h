@@ -0,0 +1,79 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/**
+ * Lock-free multi-producer, single-consumer mailbox
+ * Producers push onto an atomic stack; the consumer detaches the whole
+ * stack with one exchange and replays it oldest first. Because the consumer
+ * never pops single nodes, the stack is immune to ABA.
+ */
+template <typename T>
+class Mailbox {
+private:
+    struct Node {
+        T value;
+        Node* next;
+
+        explicit Node(T item) : value(std::move(item)), next(nullptr) {}
+    };
+
+    std::atomic<Node*> head;
+
+public:
+    Mailbox() : head(nullptr) {}
+
+    ~Mailbox() {
+        drain([](T&) {});
+    }
+
+    // Delete copy constructor and assignment operator
+    Mailbox(const Mailbox&) = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+
+    // Any thread. Returns true if the mailbox was empty, i.e. the consumer
+    // needs a wakeup; later pushes ride along with that one
+    bool push(T item) {
+        Node* node = new Node(std::move(item));
+        Node* old_head = head.load(std::memory_order_relaxed);
+        do {
+            node->next = old_head;
+        } while (!head.compare_exchange_weak(old_head, node, std::memory_order_release,
+                                             std::memory_order_relaxed));
+        return old_head == nullptr;
+    }
+
+    // Consumer thread only. Calls handler on every item in push order
+    template <typename Handler>
+    size_t drain(Handler&& handler) {
+        Node* stack = head.exchange(nullptr, std::memory_order_acquire);
+
+        // Reverse the stack into FIFO order
+        Node* list = nullptr;
+        while (stack) {
+            Node* next = stack->next;
+            stack->next = list;
+            list = stack;
+            stack = next;
+        }
+
+        size_t count = 0;
+        while (list) {
+            Node* next = list->next;
+            handler(list->value);
+            delete list;
+            list = next;
+            count++;
+        }
+        return count;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == nullptr;
+    }
+};
+
+#endif
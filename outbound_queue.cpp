@@ -0,0 +1,175 @@
+#include "outbound_queue.h"
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace {
+
+// Describe the unsent bytes of up to max_iov segments; returns the iovec count
+size_t gather_frames(const std::deque<PendingSend>& frames, struct iovec* iov, size_t max_iov) {
+    size_t count = 0;
+    
+    for (const PendingSend& pending : frames) {
+        // Segments in wire order; offset counts bytes already sent across both
+        const char* segments[2] = {nullptr, nullptr};
+        size_t lengths[2] = {0, 0};
+        if (pending.frame.head) {
+            segments[0] = pending.frame.head->data();
+            lengths[0] = pending.frame.head->size();
+        }
+        if (pending.frame.body) {
+            segments[1] = pending.frame.body->data();
+            lengths[1] = pending.frame.body->size();
+        }
+        
+        size_t skip = pending.offset;
+        for (int i = 0; i < 2; ++i) {
+            if (skip >= lengths[i]) {
+                skip -= lengths[i];
+                continue;
+            }
+            if (count == max_iov) {
+                return count;
+            }
+            iov[count].iov_base = const_cast<char*>(segments[i] + skip);
+            iov[count].iov_len = lengths[i] - skip;
+            count++;
+            skip = 0;
+        }
+    }
+    
+    return count;
+}
+
+// Retire sent bytes from the front of frames
+void consume_frames(std::deque<PendingSend>& frames, size_t sent) {
+    while (sent > 0 && !frames.empty()) {
+        PendingSend& front = frames.front();
+        size_t remaining = front.frame.size() - front.offset;
+        if (sent < remaining) {
+            front.offset += sent;
+            return;
+        }
+        sent -= remaining;
+        frames.pop_front();
+    }
+}
+
+}  // namespace
+
+OutboundQueue::OutboundQueue(int fd, size_t max_frames, SlowConsumerPolicy overflow_policy)
+    : socket_fd(fd), limit(max_frames), policy(overflow_policy),
+      closed(false), dropped(0), high_water(0), flush_scheduled(false) {
+    if (max_frames == 0) {
+        throw std::invalid_argument("Outbound queue limit must be positive");
+    }
+}
+
+EnqueueResult OutboundQueue::push(WireFrame frame) {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    
+    if (closed) {
+        return EnqueueResult::CLOSED;
+    }
+    
+    EnqueueResult result = EnqueueResult::QUEUED;
+    if (frames.size() >= limit) {
+        // A partially written front frame must finish, or the stream is corrupted
+        size_t victim = (frames.front().offset > 0) ? 1 : 0;
+        
+        if (policy == SlowConsumerPolicy::DISCONNECT) {
+            closed = true;
+            frames.clear();
+            shutdown(socket_fd, SHUT_RDWR);
+            return EnqueueResult::OVERFLOW;
+        }
+        if (policy == SlowConsumerPolicy::DROP_NEWEST || victim >= frames.size()) {
+            dropped++;
+            return EnqueueResult::DROPPED_NEWEST;
+        }
+        frames.erase(frames.begin() + static_cast<std::ptrdiff_t>(victim));
+        dropped++;
+        result = EnqueueResult::DROPPED_OLDEST;
+    }
+    
+    frames.emplace_back(std::move(frame));
+    if (frames.size() > high_water) {
+        high_water = frames.size();
+    }
+    return result;
+}
+
+FlushResult OutboundQueue::flush() {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    
+    struct iovec iov[OUTBOUND_IOV_MAX];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    
+    while (!frames.empty() && !closed) {
+        msg.msg_iovlen = gather_frames(frames, iov, OUTBOUND_IOV_MAX);
+        
+        ssize_t sent = sendmsg(socket_fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return FlushResult::PENDING;
+            }
+            // Hard error: make the reader side notice and clean up
+            closed = true;
+            frames.clear();
+            shutdown(socket_fd, SHUT_RDWR);
+            return FlushResult::FAILED;
+        }
+        
+        consume_frames(frames, static_cast<size_t>(sent));
+    }
+    
+    return closed ? FlushResult::FAILED : FlushResult::DRAINED;
+}
+
+void OutboundQueue::close() {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    closed = true;
+    frames.clear();
+}
+
+size_t OutboundQueue::depth() const {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return frames.size();
+}
+
+uint64_t OutboundQueue::get_dropped() const {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return dropped;
+}
+
+size_t OutboundQueue::get_high_water() const {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return high_water;
+}
+
+bool parse_slow_consumer_policy(const std::string& name, SlowConsumerPolicy& policy) {
+    if (name == "drop-oldest") {
+        policy = SlowConsumerPolicy::DROP_OLDEST;
+    } else if (name == "drop-newest") {
+        policy = SlowConsumerPolicy::DROP_NEWEST;
+    } else if (name == "disconnect") {
+        policy = SlowConsumerPolicy::DISCONNECT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* slow_consumer_policy_name(SlowConsumerPolicy policy) {
+    switch (policy) {
+        case SlowConsumerPolicy::DROP_OLDEST: return "drop-oldest";
+        case SlowConsumerPolicy::DROP_NEWEST: return "drop-newest";
+        case SlowConsumerPolicy::DISCONNECT:  return "disconnect";
+    }
+    return "unknown";
+}
@@ -0,0 +1,93 @@
+#ifndef OUTBOUND_QUEUE_H
+#define OUTBOUND_QUEUE_H
+
+#include "common.h"
+#include "protocol.h"
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <string>
+
+// What to do when a client's outbound queue is full
+enum class SlowConsumerPolicy {
+    DROP_OLDEST,  // Discard the oldest unsent frame to make room
+    DROP_NEWEST,  // Discard the frame being queued
+    DISCONNECT    // Shut the connection down
+};
+
+enum class EnqueueResult {
+    QUEUED,
+    DROPPED_OLDEST,  // Queued, but an older frame was discarded
+    DROPPED_NEWEST,  // Not queued
+    OVERFLOW,        // Not queued, connection is being shut down
+    CLOSED           // Not queued, the queue was already closed
+};
+
+enum class FlushResult {
+    DRAINED,  // Queue is empty
+    PENDING,  // Socket buffer is full, wait for writability
+    FAILED    // Socket error or queue closed
+};
+
+// A frame waiting to be written, with progress through it
+struct PendingSend {
+    WireFrame frame;
+    size_t offset;
+
+    explicit PendingSend(WireFrame wire_frame) : frame(std::move(wire_frame)), offset(0) {}
+};
+
+/**
+ * Bounded per-connection queue of encoded frames
+ * Broadcasters only append and attempt a non-blocking flush, so a client
+ * with a full socket buffer costs them a queue push instead of a stall.
+ * The queue owns no fd lifetime: close() must be called before the socket
+ * is closed so a late flush cannot write into a recycled descriptor.
+ */
+class OutboundQueue {
+private:
+    int socket_fd;
+    size_t limit;
+    SlowConsumerPolicy policy;
+    std::deque<PendingSend> frames;
+    bool closed;
+    uint64_t dropped;
+    size_t high_water;
+    std::atomic<bool> flush_scheduled;
+    mutable std::mutex queue_mutex;
+
+public:
+    OutboundQueue(int fd, size_t max_frames, SlowConsumerPolicy overflow_policy);
+
+    // Delete copy constructor and assignment operator
+    OutboundQueue(const OutboundQueue&) = delete;
+    OutboundQueue& operator=(const OutboundQueue&) = delete;
+
+    EnqueueResult push(WireFrame frame);
+
+    // Write queued frames, gathered into one sendmsg per batch, until done
+    // or the socket would block
+    FlushResult flush();
+
+    // Stop all further writes; the socket is about to be closed
+    void close();
+    
+    // Claim the single pending flush request for another thread to run;
+    // false if one is already on its way
+    bool schedule_flush() { return !flush_scheduled.exchange(true, std::memory_order_acq_rel); }
+    
+    // The thread running a scheduled flush calls this first, so frames pushed
+    // while it flushes schedule a new request
+    void begin_scheduled_flush() { flush_scheduled.store(false, std::memory_order_release); }
+
+    int get_fd() const { return socket_fd; }
+    size_t depth() const;
+    uint64_t get_dropped() const;
+    size_t get_high_water() const;
+};
+
+// Parse a --slow-consumer value
+bool parse_slow_consumer_policy(const std::string& name, SlowConsumerPolicy& policy);
+const char* slow_consumer_policy_name(SlowConsumerPolicy policy);
+
+#endif
@@ -0,0 +1,186 @@
+#include "protocol.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+void write_u32(char* out, uint32_t value) {
+    out[0] = static_cast<char>(value >> 24);
+    out[1] = static_cast<char>(value >> 16);
+    out[2] = static_cast<char>(value >> 8);
+    out[3] = static_cast<char>(value);
+}
+
+void write_u64(char* out, uint64_t value) {
+    write_u32(out, static_cast<uint32_t>(value >> 32));
+    write_u32(out + 4, static_cast<uint32_t>(value));
+}
+
+uint32_t read_u32(const char* in) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(in);
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint64_t read_u64(const char* in) {
+    return (static_cast<uint64_t>(read_u32(in)) << 32) | read_u32(in + 4);
+}
+
+// Header plus sender; the payload follows on the wire
+void write_header(char* out, const Message& msg, size_t sender_len, size_t payload_len,
+                  uint32_t sequence) {
+    out[0] = static_cast<char>(msg.type);
+    out[1] = static_cast<char>(FRAME_FLAG_NONE);
+    out[2] = static_cast<char>(sender_len);
+    out[3] = 0;
+    write_u32(out + 4, static_cast<uint32_t>(payload_len));
+    write_u32(out + 8, sequence);
+    write_u64(out + 12, static_cast<uint64_t>(msg.timestamp));
+    memcpy(out + FRAME_HEADER_SIZE, msg.sender, sender_len);
+}
+
+}  // namespace
+
+DecodeStatus parse_hello(const char* data, size_t length, bool input_idle, std::string& user_id,
+                         uint8_t& version, size_t& consumed) {
+    // Registration refuses longer names, so there is no need to wait for one to end
+    size_t window = std::min(length, static_cast<size_t>(USERNAME_MAX_LEN) + 1);
+    size_t name_len = strnlen(data, window);
+    if (name_len > static_cast<size_t>(USERNAME_MAX_LEN)) {
+        return DecodeStatus::INVALID;
+    }
+    version = PROTOCOL_LEGACY;
+
+    if (name_len == length) {
+        // No terminator yet: either a legacy name or the start of a split hello
+        if (!input_idle || length == 0) {
+            return DecodeStatus::INCOMPLETE;
+        }
+        user_id.assign(data, length);
+        consumed = length;
+        return DecodeStatus::COMPLETE;
+    }
+
+    // Newer clients append "\0CHAT<version>"; wait while what follows the NUL could still be it
+    user_id.assign(data, name_len);
+    size_t ext = name_len + 1;
+    size_t present = std::min(length - ext, sizeof(PROTOCOL_MAGIC));
+    if (memcmp(data + ext, PROTOCOL_MAGIC, present) != 0) {
+        consumed = ext;
+        return DecodeStatus::COMPLETE;
+    }
+    if (length - ext < PROTOCOL_ACK_SIZE) {
+        return DecodeStatus::INCOMPLETE;
+    }
+    uint8_t offered = static_cast<uint8_t>(data[ext + sizeof(PROTOCOL_MAGIC)]);
+    version = std::min(offered, PROTOCOL_VERSION);
+    consumed = ext + PROTOCOL_ACK_SIZE;
+    return DecodeStatus::COMPLETE;
+}
+
+std::vector<char> encode_hello(const std::string& user_id, uint8_t version) {
+    std::vector<char> out(user_id.begin(), user_id.end());
+    out.push_back('\0');
+    out.insert(out.end(), PROTOCOL_MAGIC, PROTOCOL_MAGIC + sizeof(PROTOCOL_MAGIC));
+    out.push_back(static_cast<char>(version));
+    return out;
+}
+
+std::vector<char> encode_hello_ack(uint8_t version) {
+    std::vector<char> out(PROTOCOL_MAGIC, PROTOCOL_MAGIC + sizeof(PROTOCOL_MAGIC));
+    out.push_back(static_cast<char>(version));
+    return out;
+}
+
+bool parse_hello_ack(const char* data, size_t length, uint8_t& version) {
+    if (length < PROTOCOL_ACK_SIZE || memcmp(data, PROTOCOL_MAGIC, sizeof(PROTOCOL_MAGIC)) != 0) {
+        return false;
+    }
+    version = static_cast<uint8_t>(data[sizeof(PROTOCOL_MAGIC)]);
+    return true;
+}
+
+std::vector<char> encode_message(const Message& msg, uint8_t version, uint32_t sequence) {
+    if (version == PROTOCOL_LEGACY) {
+        const char* bytes = reinterpret_cast<const char*>(&msg);
+        return std::vector<char>(bytes, bytes + sizeof(Message));
+    }
+
+    size_t sender_len = strnlen(msg.sender, sizeof(msg.sender) - 1);
+    size_t payload_len = std::min<size_t>(msg.payload_size, sizeof(msg.payload) - 1);
+
+    std::vector<char> out(FRAME_HEADER_SIZE + sender_len + payload_len);
+    write_header(out.data(), msg, sender_len, payload_len, sequence);
+    memcpy(out.data() + FRAME_HEADER_SIZE + sender_len, msg.payload, payload_len);
+    return out;
+}
+
+SharedPayload share_payload(const Message& msg) {
+    size_t payload_len = std::min<size_t>(msg.payload_size, sizeof(msg.payload) - 1);
+    return std::make_shared<const std::string>(msg.payload, payload_len);
+}
+
+WireFrame encode_frame(const Message& msg, uint8_t version, uint32_t sequence,
+                       const SharedPayload& payload) {
+    WireFrame frame;
+    if (version == PROTOCOL_LEGACY) {
+        // The legacy struct embeds the payload, so it is one contiguous buffer
+        frame.head = std::make_shared<std::vector<char>>(encode_message(msg, version, sequence));
+        return frame;
+    }
+
+    size_t sender_len = strnlen(msg.sender, sizeof(msg.sender) - 1);
+
+    auto head = std::make_shared<std::vector<char>>(FRAME_HEADER_SIZE + sender_len);
+    write_header(head->data(), msg, sender_len, payload->size(), sequence);
+    frame.head = std::move(head);
+    frame.body = payload;
+    return frame;
+}
+
+size_t frame_size(const char* header) {
+    size_t sender_len = static_cast<unsigned char>(header[2]);
+    uint32_t payload_len = read_u32(header + 4);
+    if (sender_len >= sizeof(Message::sender) || payload_len >= sizeof(Message::payload)) {
+        return 0;
+    }
+    return FRAME_HEADER_SIZE + sender_len + payload_len;
+}
+
+DecodeStatus decode_message(const char* data, size_t available, uint8_t version,
+                            Message& msg, size_t& consumed) {
+    if (version == PROTOCOL_LEGACY) {
+        if (available < sizeof(Message)) {
+            return DecodeStatus::INCOMPLETE;
+        }
+        memcpy(&msg, data, sizeof(Message));
+        consumed = sizeof(Message);
+        return DecodeStatus::COMPLETE;
+    }
+
+    if (available < FRAME_HEADER_SIZE) {
+        return DecodeStatus::INCOMPLETE;
+    }
+
+    size_t total = frame_size(data);
+    if (total == 0) {
+        return DecodeStatus::INVALID;
+    }
+    if (available < total) {
+        return DecodeStatus::INCOMPLETE;
+    }
+
+    size_t sender_len = static_cast<unsigned char>(data[2]);
+    uint32_t payload_len = read_u32(data + 4);
+
+    msg.type = static_cast<uint8_t>(data[0]);
+    msg.timestamp = static_cast<time_t>(read_u64(data + 12));
+    memcpy(msg.sender, data + FRAME_HEADER_SIZE, sender_len);
+    msg.sender[sender_len] = '\0';
+    memcpy(msg.payload, data + FRAME_HEADER_SIZE + sender_len, payload_len);
+    msg.payload[payload_len] = '\0';
+    msg.payload_size = payload_len;
+
+    consumed = total;
+    return DecodeStatus::COMPLETE;
+}
@@ -0,0 +1,99 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "common.h"
+#include <string>
+#include <vector>
+#include <memory>
+
+/**
+ * Wire protocol
+ *
+ * Version 0 (legacy): the client sends its user ID as raw bytes, then every
+ * message in either direction is a full sizeof(Message) struct.
+ *
+ * Version 1 (framed): the client sends "<user_id>\0CHAT<version>". Legacy
+ * servers stop at the NUL and still see a plain user ID; newer servers reply
+ * "CHAT<version>" with the version they accepted. Each message is then a
+ * FRAME_HEADER_SIZE header followed by sender_len sender bytes and exactly
+ * length payload bytes. Header fields are big-endian:
+ *
+ *   0  type        u8
+ *   1  flags       u8
+ *   2  sender_len  u8
+ *   3  reserved    u8
+ *   4  length      u32   payload bytes
+ *   8  sequence    u32
+ *   12 timestamp   i64
+ */
+
+constexpr uint8_t PROTOCOL_LEGACY = 0;
+constexpr uint8_t PROTOCOL_FRAMED = 1;
+constexpr uint8_t PROTOCOL_VERSION = PROTOCOL_FRAMED;  // Highest version we speak
+
+constexpr char PROTOCOL_MAGIC[4] = {'C', 'H', 'A', 'T'};
+constexpr size_t PROTOCOL_ACK_SIZE = sizeof(PROTOCOL_MAGIC) + 1;
+constexpr size_t FRAME_HEADER_SIZE = 20;
+constexpr uint8_t FRAME_FLAG_NONE = 0x00;
+
+// Largest encoding of a single message in any protocol version
+constexpr size_t MAX_FRAME_SIZE =
+    sizeof(Message) > FRAME_HEADER_SIZE + USERNAME_MAX_LEN + BUFFER_SIZE - 1
+        ? sizeof(Message)
+        : FRAME_HEADER_SIZE + USERNAME_MAX_LEN + BUFFER_SIZE - 1;
+
+// Immutable encoded message shared by every recipient of a broadcast
+using SendBuffer = std::shared_ptr<const std::vector<char>>;
+
+// Immutable message text shared by the cache and every framed recipient
+using SharedPayload = std::shared_ptr<const std::string>;
+
+// One outgoing message: an encoded head plus an optional shared body that
+// follows it on the wire. Framed encodings keep the payload in body so it is
+// never copied per recipient; writers send both with one gather write.
+struct WireFrame {
+    SendBuffer head;
+    SharedPayload body;
+
+    size_t size() const { return (head ? head->size() : 0) + (body ? body->size() : 0); }
+};
+
+// Result of trying to decode one message from buffered input
+enum class DecodeStatus {
+    COMPLETE,    // A message was decoded
+    INCOMPLETE,  // More bytes are needed
+    INVALID      // Malformed input, the connection should be dropped
+};
+
+// Parse the client hello at the front of data into its user ID and protocol
+// version, and say how many bytes it took. A framed hello ends after its
+// "\0CHAT<version>"; a legacy one is a bare name with no terminator, so it is
+// only taken, as all of data, once input_idle says nothing more is waiting
+DecodeStatus parse_hello(const char* data, size_t length, bool input_idle, std::string& user_id,
+                         uint8_t& version, size_t& consumed);
+
+// Build the client hello / server acknowledgement
+std::vector<char> encode_hello(const std::string& user_id, uint8_t version);
+std::vector<char> encode_hello_ack(uint8_t version);
+
+// Check for a server acknowledgement; returns false for anything else
+bool parse_hello_ack(const char* data, size_t length, uint8_t& version);
+
+// Encode a message in the given protocol version
+std::vector<char> encode_message(const Message& msg, uint8_t version, uint32_t sequence);
+
+// Copy a message's payload once into a buffer that frames and the cache can share
+SharedPayload share_payload(const Message& msg);
+
+// Encode a message around an already shared payload (from share_payload)
+WireFrame encode_frame(const Message& msg, uint8_t version, uint32_t sequence,
+                       const SharedPayload& payload);
+
+// Total size of a framed message given its complete header, 0 if the header is invalid
+size_t frame_size(const char* header);
+
+// Decode one message from the front of data
+DecodeStatus decode_message(const char* data, size_t available, uint8_t version,
+                            Message& msg, size_t& consumed);
+
+#endif
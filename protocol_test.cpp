@@ -0,0 +1,249 @@
+#include "protocol.h"
+#include "frame_reader.h"
+#include "reactor.h"
+#include "common.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+void print_separator() {
+    std::cout << std::string(70, '=') << std::endl;
+}
+
+void print_test_header(const std::string& test_name) {
+    print_separator();
+    std::cout << "TEST: " << test_name << std::endl;
+    print_separator();
+}
+
+const char* pass_fail(bool ok) {
+    return ok ? "✓ PASS" : "✗ FAIL";
+}
+
+Message make_text(const std::string& sender, const std::string& text) {
+    Message msg;
+    msg.type = MSG_TEXT;
+    strncpy(msg.sender, sender.c_str(), sizeof(msg.sender) - 1);
+    strncpy(msg.payload, text.c_str(), sizeof(msg.payload) - 1);
+    msg.payload_size = static_cast<uint32_t>(text.size());
+    msg.timestamp = time(nullptr);
+    return msg;
+}
+
+std::vector<char> hello_then_frame(const std::string& user_id, const std::string& text) {
+    std::vector<char> bytes = encode_hello(user_id, PROTOCOL_FRAMED);
+    std::vector<char> frame = encode_message(make_text(user_id, text), PROTOCOL_FRAMED, 1);
+    bytes.insert(bytes.end(), frame.begin(), frame.end());
+    return bytes;
+}
+
+bool send_all(int fd, const char* data, size_t length) {
+    return send(fd, data, length, MSG_NOSIGNAL) == static_cast<ssize_t>(length);
+}
+
+void test_hello_through_reader() {
+    print_test_header("Hello Through the Frame Reader");
+
+    std::cout << "\n1. Hello and first frame in one send..." << std::endl;
+    {
+        int fds[2];
+        socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        std::vector<char> bytes = hello_then_frame("alice", "first");
+        send_all(fds[1], bytes.data(), bytes.size());
+
+        FrameReader reader;
+        reader.fill(fds[0]);
+        std::string user_id;
+        uint8_t version = PROTOCOL_LEGACY;
+        DecodeStatus hello = reader.hello(user_id, version, true);
+        Message msg;
+        DecodeStatus frame = reader.next(msg);
+        bool ok = hello == DecodeStatus::COMPLETE && user_id == "alice" && version == PROTOCOL_FRAMED &&
+                  frame == DecodeStatus::COMPLETE && std::string(msg.payload) == "first";
+        std::cout << "   Hello parsed, frame kept for next(): " << pass_fail(ok) << std::endl;
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    std::cout << "\n2. Hello split after the NUL..." << std::endl;
+    {
+        int fds[2];
+        socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+        std::vector<char> bytes = hello_then_frame("bob", "second");
+        size_t split = strlen("bob") + 1;
+        send_all(fds[1], bytes.data(), split);
+
+        FrameReader reader;
+        reader.fill(fds[0]);
+        std::string user_id;
+        uint8_t version = PROTOCOL_LEGACY;
+        DecodeStatus first = reader.hello(user_id, version, true);
+
+        send_all(fds[1], bytes.data() + split, bytes.size() - split);
+        reader.fill(fds[0]);
+        DecodeStatus second = reader.hello(user_id, version, true);
+        Message msg;
+        DecodeStatus frame = reader.next(msg);
+        bool ok = first == DecodeStatus::INCOMPLETE && second == DecodeStatus::COMPLETE && user_id == "bob" &&
+                  version == PROTOCOL_FRAMED && frame == DecodeStatus::COMPLETE && std::string(msg.payload) == "second";
+        std::cout << "   Waited for the rest, then framed: " << pass_fail(ok) << std::endl;
+        close(fds[0]);
+        close(fds[1]);
+    }
+
+    std::cout << "\n3. Legacy bare name..." << std::endl;
+    {
+        std::string user_id;
+        uint8_t version = PROTOCOL_FRAMED;
+        size_t consumed = 0;
+        DecodeStatus busy = parse_hello("carol", 5, false, user_id, version, consumed);
+        DecodeStatus idle = parse_hello("carol", 5, true, user_id, version, consumed);
+        bool ok = busy == DecodeStatus::INCOMPLETE && idle == DecodeStatus::COMPLETE && user_id == "carol" &&
+                  version == PROTOCOL_LEGACY && consumed == 5;
+        std::cout << "   Taken once the input is idle: " << pass_fail(ok) << std::endl;
+    }
+
+    std::cout << "\n4. Name longer than USERNAME_MAX_LEN with no terminator..." << std::endl;
+    {
+        std::string name(USERNAME_MAX_LEN + 1, 'x');
+        std::string user_id;
+        uint8_t version = PROTOCOL_LEGACY;
+        size_t consumed = 0;
+        DecodeStatus status = parse_hello(name.data(), name.size(), false, user_id, version, consumed);
+        std::cout << "   Rejected without waiting: " << pass_fail(status == DecodeStatus::INVALID) << std::endl;
+    }
+}
+
+// Records what a reactor hands its handlers
+struct Recorder {
+    std::mutex mutex;
+    std::vector<std::string> opened;   // "user/version"
+    std::vector<std::string> messages; // "user:payload"
+    std::atomic<int> message_count{0};
+};
+
+bool wait_for_messages(const Recorder& recorder, int wanted) {
+    for (int i = 0; i < 300 && recorder.message_count.load() < wanted; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return recorder.message_count.load() >= wanted;
+}
+
+int connect_to(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void test_reactor_hello() {
+    print_test_header("Reactor Hello Split and Merge");
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(listen_fd, 8) < 0 || getsockname(listen_fd, reinterpret_cast<struct sockaddr*>(&addr), &addr_len) < 0) {
+        throw std::runtime_error("Failed to set up a loopback listener");
+    }
+
+    Recorder recorder;
+    ReactorHandlers handlers;
+    handlers.on_open = [&recorder](int, const std::string& user_id, uint8_t version) {
+        std::lock_guard<std::mutex> lock(recorder.mutex);
+        recorder.opened.push_back(user_id + "/" + std::to_string(version));
+        return true;
+    };
+    handlers.on_message = [&recorder](int, const std::string& user_id, Message& msg) {
+        std::lock_guard<std::mutex> lock(recorder.mutex);
+        recorder.messages.push_back(user_id + ":" + msg.payload);
+        recorder.message_count++;
+    };
+    handlers.on_close = [](int, const std::string&) {};
+
+    ThreadPool pool(2);
+    Reactor reactor(listen_fd, pool, handlers);
+    std::atomic<bool> running(true);
+    std::thread loop([&]() { reactor.run(running); });
+    uint16_t port = ntohs(addr.sin_port);
+
+    std::cout << "\n1. Hello and first frame in one send..." << std::endl;
+    int merged = connect_to(port);
+    std::vector<char> bytes = hello_then_frame("alice", "merged");
+    send_all(merged, bytes.data(), bytes.size());
+    bool got = wait_for_messages(recorder, 1);
+    {
+        std::lock_guard<std::mutex> lock(recorder.mutex);
+        bool ok = got && recorder.opened.size() == 1 && recorder.opened[0] == "alice/1" &&
+                  recorder.messages[0] == "alice:merged";
+        std::cout << "   Registered framed, frame delivered: " << pass_fail(ok) << std::endl;
+    }
+
+    std::cout << "\n2. Hello in two sends, \"bob\\0\" then \"CHAT1\" and a frame..." << std::endl;
+    int split = connect_to(port);
+    bytes = hello_then_frame("bob", "split");
+    size_t cut = strlen("bob") + 1;
+    send_all(split, bytes.data(), cut);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    send_all(split, bytes.data() + cut, bytes.size() - cut);
+    got = wait_for_messages(recorder, 2);
+    {
+        std::lock_guard<std::mutex> lock(recorder.mutex);
+        bool ok = got && recorder.opened.size() == 2 && recorder.opened[1] == "bob/1" &&
+                  recorder.messages[1] == "bob:split";
+        std::cout << "   Registered framed, frame delivered: " << pass_fail(ok) << std::endl;
+    }
+
+    running = false;
+    loop.join();
+    close(merged);
+    close(split);
+    close(listen_fd);
+}
+
+int main() {
+    std::cout << "\n";
+    print_separator();
+    std::cout << "    PROTOCOL TEST SUITE" << std::endl;
+    std::cout << "    Testing Hello Reassembly" << std::endl;
+    print_separator();
+    std::cout << std::endl;
+
+    try {
+        test_hello_through_reader();
+        std::cout << "\n\n";
+
+        test_reactor_hello();
+        std::cout << "\n\n";
+
+        print_separator();
+        std::cout << "✓ ALL TESTS COMPLETED SUCCESSFULLY" << std::endl;
+        print_separator();
+        std::cout << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "\n✗ TEST FAILED WITH EXCEPTION: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,410 @@
+#include "reactor.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+bool set_nonblocking(int socket_fd) {
+    int flags = fcntl(socket_fd, F_GETFL, 0);
+    if (flags < 0) {
+        return false;
+    }
+    return fcntl(socket_fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+Reactor::Reactor(int listen_socket, ThreadPool& thread_pool, ReactorHandlers reactor_handlers)
+    : epoll_fd(-1), write_epoll_fd(-1), wake_fd(-1), listen_fd(listen_socket), pool(&thread_pool),
+      handlers(std::move(reactor_handlers)), inflight(0) {
+    setup(listen_socket);
+    std::cout << "[Reactor] Created epoll event loop (edge-triggered)" << std::endl;
+}
+
+Reactor::Reactor(int listen_socket, ReactorHandlers reactor_handlers)
+    : epoll_fd(-1), write_epoll_fd(-1), wake_fd(-1), listen_fd(listen_socket), pool(nullptr),
+      handlers(std::move(reactor_handlers)), inflight(0) {
+    setup(listen_socket);
+}
+
+void Reactor::setup(int listen_socket) {
+    if (!handlers.on_open || !handlers.on_message || !handlers.on_close) {
+        throw std::invalid_argument("Reactor handlers must not be empty");
+    }
+    
+    auto fail = [this](const std::string& what) {
+        int saved = errno;
+        for (int fd : {wake_fd, write_epoll_fd, epoll_fd}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        throw std::runtime_error(what + ": " + strerror(saved));
+    };
+    
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        fail("epoll_create1 failed");
+    }
+    
+    if (!set_nonblocking(listen_socket)) {
+        fail("Failed to make listening socket non-blocking");
+    }
+    
+    // The listening socket stays level-triggered; it is only touched by the loop thread
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_socket;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_socket, &ev) < 0) {
+        fail("Failed to register listening socket");
+    }
+    
+    // The write set reports readable to the main loop whenever it has a ready socket
+    write_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    ev.data.fd = write_epoll_fd;
+    if (write_epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, write_epoll_fd, &ev) < 0) {
+        fail("Failed to create write epoll set");
+    }
+    
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ev.data.fd = wake_fd;
+    if (wake_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev) < 0) {
+        fail("Failed to create mailbox eventfd");
+    }
+}
+
+Reactor::~Reactor() {
+    if (wake_fd >= 0) {
+        close(wake_fd);
+    }
+    if (write_epoll_fd >= 0) {
+        close(write_epoll_fd);
+    }
+    if (epoll_fd >= 0) {
+        close(epoll_fd);
+    }
+}
+
+void Reactor::run(const std::atomic<bool>& running) {
+    std::vector<struct epoll_event> events(MAX_EVENTS);
+    std::vector<Task> batch;
+    std::vector<std::shared_ptr<ReactorConnection>> batch_connections;
+    batch.reserve(MAX_EVENTS);
+    batch_connections.reserve(MAX_EVENTS);
+    
+    while (running.load()) {
+        int ready = epoll_wait(epoll_fd, events.data(), MAX_EVENTS, EPOLL_TIMEOUT_MS);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "[Reactor] epoll_wait failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd) {
+                accept_connections();
+                continue;
+            }
+            if (fd == write_epoll_fd) {
+                dispatch_writable();
+                continue;
+            }
+            if (fd == wake_fd) {
+                run_posted();
+                continue;
+            }
+            
+            std::shared_ptr<ReactorConnection> conn;
+            {
+                std::lock_guard<std::mutex> lock(connections_mutex);
+                auto it = connections.find(fd);
+                if (it != connections.end()) {
+                    conn = it->second;
+                }
+            }
+            if (!conn) {
+                continue;
+            }
+            
+            uint32_t ready_events = events[i].events;
+            if (!pool) {
+                handle_event(conn, ready_events);
+                continue;
+            }
+            
+            batch.emplace_back([this, conn, ready_events]() {
+                handle_event(conn, ready_events);
+                inflight--;
+            });
+            batch_connections.push_back(conn);
+        }
+        
+        // Everything this wakeup found goes to the pool at once, waking as
+        // many workers as it needs with one call
+        if (!batch.empty()) {
+            inflight += static_cast<int>(batch.size());
+            try {
+                pool->submit_bulk(batch.data(), batch.size());
+            } catch (const std::exception& e) {
+                inflight -= static_cast<int>(batch.size());
+                std::cerr << "[Reactor] Failed to dispatch events: " << e.what() << std::endl;
+                for (const auto& conn : batch_connections) {
+                    close_connection(conn);
+                }
+            }
+            batch.clear();
+            batch_connections.clear();
+        }
+    }
+    
+    // Let in-flight handlers finish before tearing connections down
+    while (inflight.load() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    
+    std::vector<std::shared_ptr<ReactorConnection>> remaining;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        for (auto& [fd, conn] : connections) {
+            remaining.push_back(conn);
+        }
+    }
+    for (auto& conn : remaining) {
+        close_connection(conn);
+    }
+    
+    std::cout << "[Reactor] Event loop stopped" << std::endl;
+}
+
+void Reactor::accept_connections() {
+    while (true) {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        int client_socket = accept4(listen_fd, (struct sockaddr*)&client_addr, &client_len,
+                                    SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_socket < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "[Reactor] Accept failed: " << strerror(errno) << std::endl;
+            }
+            return;
+        }
+        
+        if (handlers.on_accept) {
+            char client_ip[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+            handlers.on_accept(client_socket, client_ip);
+        }
+        
+        auto conn = std::make_shared<ReactorConnection>(client_socket);
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            connections[client_socket] = conn;
+        }
+        
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = client_events();
+        ev.data.fd = client_socket;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_socket, &ev) < 0) {
+            std::cerr << "[Reactor] Failed to register client socket: " << strerror(errno) << std::endl;
+            {
+                std::lock_guard<std::mutex> lock(connections_mutex);
+                connections.erase(client_socket);
+            }
+            close(client_socket);
+        }
+    }
+}
+
+void Reactor::dispatch_writable() {
+    std::vector<struct epoll_event> events(MAX_EVENTS);
+    int ready = epoll_wait(write_epoll_fd, events.data(), MAX_EVENTS, 0);
+    if (ready <= 0) {
+        return;
+    }
+    
+    if (!pool) {
+        for (int i = 0; i < ready; ++i) {
+            handlers.on_writable(events[i].data.fd);
+        }
+        return;
+    }
+    
+    // Flushes finish broadcasts that are already on their way, so they go
+    // ahead of new reads
+    std::vector<Task> flushes;
+    flushes.reserve(ready);
+    for (int i = 0; i < ready; ++i) {
+        int fd = events[i].data.fd;
+        flushes.emplace_back([this, fd]() {
+            handlers.on_writable(fd);
+            inflight--;
+        });
+    }
+    inflight += ready;
+    try {
+        pool->submit_bulk(flushes.data(), flushes.size(), TaskPriority::HIGH);
+    } catch (const std::exception& e) {
+        inflight -= ready;
+        std::cerr << "[Reactor] Failed to dispatch write events: " << e.what() << std::endl;
+    }
+}
+
+void Reactor::post(std::function<void()> task) {
+    // Only the push that finds the mailbox empty needs to wake the loop
+    if (mailbox.push(std::move(task))) {
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            std::cerr << "[Reactor] Failed to wake event loop: " << strerror(errno) << std::endl;
+        }
+    }
+}
+
+void Reactor::run_posted() {
+    uint64_t count;
+    while (read(wake_fd, &count, sizeof(count)) < 0 && errno == EINTR) {
+    }
+    
+    mailbox.drain([](std::function<void()>& task) {
+        try {
+            task();
+        } catch (const std::exception& e) {
+            std::cerr << "[Reactor] Exception in posted task: " << e.what() << std::endl;
+        }
+    });
+}
+
+uint32_t Reactor::client_events() const {
+    // With a pool, one-shot arming keeps a socket on at most one worker;
+    // inline shards only ever touch their sockets from the loop thread
+    uint32_t events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    return pool ? (events | EPOLLONESHOT) : events;
+}
+
+void Reactor::watch_writable(int socket_fd) {
+    if (!handlers.on_writable) {
+        return;
+    }
+    
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLOUT | EPOLLONESHOT;
+    ev.data.fd = socket_fd;
+    
+    // Re-arming a one-shot entry also reports a socket that is already writable
+    if (epoll_ctl(write_epoll_fd, EPOLL_CTL_MOD, socket_fd, &ev) < 0 && errno == ENOENT) {
+        epoll_ctl(write_epoll_fd, EPOLL_CTL_ADD, socket_fd, &ev);
+    }
+}
+
+void Reactor::handle_event(const std::shared_ptr<ReactorConnection>& conn, uint32_t events) {
+    bool keep_open = false;
+    
+    try {
+        // Drain the socket first: a hangup can arrive together with the last data
+        keep_open = read_available(*conn) && !(events & EPOLLERR);
+    } catch (const std::exception& e) {
+        std::cerr << "[Reactor] Exception handling fd " << conn->socket_fd << ": " << e.what() << std::endl;
+    }
+    
+    if (!keep_open || (pool && !rearm(*conn))) {
+        close_connection(conn);
+    }
+}
+
+bool Reactor::read_available(ReactorConnection& conn) {
+    Message msg;
+    
+    // Edge-triggered: keep reading until the kernel buffer is empty
+    while (true) {
+        ssize_t bytes = conn.reader.fill(conn.socket_fd);
+        bool drained = false;
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            drained = true;
+        } else if (bytes == 0) {
+            // Peer closed the connection
+            return false;
+        }
+        
+        // The user ID and protocol hello come through the ring too: they may
+        // be split across reads or share one with the first frames
+        if (!conn.registered) {
+            std::string user_id;
+            uint8_t version;
+            DecodeStatus status = conn.reader.hello(user_id, version, drained);
+            if (status == DecodeStatus::INVALID) {
+                return false;
+            }
+            if (status == DecodeStatus::INCOMPLETE) {
+                if (drained) {
+                    return true;
+                }
+                continue;
+            }
+            if (!handlers.on_open(conn.socket_fd, user_id, version)) {
+                return false;
+            }
+            conn.user_id = user_id;
+            conn.registered = true;
+        }
+        
+        DecodeStatus status;
+        while ((status = conn.reader.next(msg)) == DecodeStatus::COMPLETE) {
+            handlers.on_message(conn.socket_fd, conn.user_id, msg);
+        }
+        if (status == DecodeStatus::INVALID) {
+            return false;
+        }
+        if (drained) {
+            return true;
+        }
+    }
+}
+
+bool Reactor::rearm(const ReactorConnection& conn) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = client_events();
+    ev.data.fd = conn.socket_fd;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn.socket_fd, &ev) == 0;
+}
+
+void Reactor::close_connection(const std::shared_ptr<ReactorConnection>& conn) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->socket_fd, nullptr);
+    epoll_ctl(write_epoll_fd, EPOLL_CTL_DEL, conn->socket_fd, nullptr);
+    
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        connections.erase(conn->socket_fd);
+    }
+    
+    // Unregister before closing so no broadcast can target a recycled fd
+    if (conn->registered) {
+        handlers.on_close(conn->socket_fd, conn->user_id);
+    }
+    close(conn->socket_fd);
+}
+
+size_t Reactor::get_connection_count() const {
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    return connections.size();
+}
@@ -0,0 +1,97 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include "common.h"
+#include "thread_pool.h"
+#include "protocol.h"
+#include "frame_reader.h"
+#include "mailbox.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+
+// Per-connection state owned by the reactor
+struct ReactorConnection {
+    int socket_fd;
+    std::string user_id;
+    bool registered;
+    FrameReader reader;  // Reassembles messages across partial and coalesced reads
+
+    explicit ReactorConnection(int fd) : socket_fd(fd), registered(false) {}
+};
+
+// Callbacks into the chat logic (on_accept runs on the loop thread, the rest on workers)
+struct ReactorHandlers {
+    std::function<void(int, const std::string&)> on_accept;
+    std::function<bool(int, const std::string&, uint8_t)> on_open;
+    std::function<void(int, const std::string&, Message&)> on_message;
+    std::function<void(int, const std::string&)> on_close;
+    std::function<void(int)> on_writable;  // Optional, see Reactor::watch_writable
+};
+
+/**
+ * Edge-triggered epoll event loop
+ * Connections are non-blocking and armed with EPOLLONESHOT, so at most one
+ * worker thread handles a given socket at a time. Workers only run while a
+ * socket is readable instead of owning it for the life of the connection.
+ * Write readiness lives in a second epoll set nested inside the first, so a
+ * broadcaster can ask for it without disturbing the read registration.
+ *
+ * Without a thread pool the reactor runs every handler inline on its own
+ * thread; this is the per-core shard used with SO_REUSEPORT listeners. Other
+ * threads hand it work through post().
+ */
+class Reactor {
+private:
+    int epoll_fd;
+    int write_epoll_fd;  // One-shot EPOLLOUT registrations, polled via epoll_fd
+    int wake_fd;         // eventfd signalled when the mailbox goes non-empty
+    int listen_fd;
+    ThreadPool* pool;    // nullptr: handle events inline on the loop thread
+    ReactorHandlers handlers;
+    Mailbox<std::function<void()>> mailbox;
+
+    std::unordered_map<int, std::shared_ptr<ReactorConnection>> connections;
+    mutable std::mutex connections_mutex;
+    std::atomic<int> inflight;
+
+    // Private helper methods
+    void setup(int listen_socket);
+    void accept_connections();
+    void dispatch_writable();
+    void run_posted();
+    uint32_t client_events() const;
+    void handle_event(const std::shared_ptr<ReactorConnection>& conn, uint32_t events);
+    bool read_available(ReactorConnection& conn);
+    bool rearm(const ReactorConnection& conn);
+    void close_connection(const std::shared_ptr<ReactorConnection>& conn);
+
+public:
+    Reactor(int listen_socket, ThreadPool& thread_pool, ReactorHandlers reactor_handlers);
+    Reactor(int listen_socket, ReactorHandlers reactor_handlers);
+    ~Reactor();
+
+    // Delete copy constructor and assignment operator
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
+    // Run the event loop until running becomes false, then close all connections
+    void run(const std::atomic<bool>& running);
+
+    // Call on_writable once the socket can take more data (any thread)
+    void watch_writable(int socket_fd);
+    
+    // Run task on the loop thread (any thread, lock-free)
+    void post(std::function<void()> task);
+
+    size_t get_connection_count() const;
+};
+
+// Put a socket into non-blocking mode
+bool set_nonblocking(int socket_fd);
+
+#endif
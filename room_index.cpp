@@ -0,0 +1,119 @@
+#include "room_index.h"
+#include <functional>
+#include <stdexcept>
+#include <cctype>
+
+RoomIndex::RoomIndex(size_t shard_count) : shards(shard_count) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("Room index needs at least one shard");
+    }
+}
+
+RoomIndex::Shard& RoomIndex::shard_for(const std::string& room) {
+    return shards[std::hash<std::string>{}(room) % shards.size()];
+}
+
+std::shared_ptr<RoomIndex::Room> RoomIndex::find(const std::string& room) {
+    Shard& shard = shard_for(room);
+    std::shared_lock<std::shared_mutex> lock(shard.rooms_mutex);
+    auto it = shard.rooms.find(room);
+    return it != shard.rooms.end() ? it->second : nullptr;
+}
+
+bool RoomIndex::contains(const std::vector<RoomMember>& members, int socket_fd) {
+    for (const RoomMember& member : members) {
+        if (member.socket_fd == socket_fd) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RoomIndex::join(const std::string& room, const RoomMember& member) {
+    // Hold the shard lock while adding, so a concurrent leave cannot retire
+    // the room between lookup and insert
+    Shard& shard = shard_for(room);
+    std::unique_lock<std::shared_mutex> lock(shard.rooms_mutex);
+
+    std::shared_ptr<Room>& target = shard.rooms[room];
+    if (!target) {
+        target = std::make_shared<Room>();
+    }
+
+    std::lock_guard<std::mutex> members_lock(target->members_mutex);
+    if (contains(target->members, member.socket_fd)) {
+        return false;
+    }
+    target->members.push_back(member);
+    return true;
+}
+
+bool RoomIndex::leave(const std::string& room, int socket_fd) {
+    Shard& shard = shard_for(room);
+    std::unique_lock<std::shared_mutex> lock(shard.rooms_mutex);
+
+    auto it = shard.rooms.find(room);
+    if (it == shard.rooms.end()) {
+        return false;
+    }
+
+    bool removed = false;
+    bool empty = false;
+    {
+        std::lock_guard<std::mutex> members_lock(it->second->members_mutex);
+        std::vector<RoomMember>& members = it->second->members;
+        for (size_t i = 0; i < members.size(); ++i) {
+            if (members[i].socket_fd == socket_fd) {
+                // Member order carries no meaning, so swap-remove
+                members[i] = std::move(members.back());
+                members.pop_back();
+                removed = true;
+                break;
+            }
+        }
+        empty = members.empty();
+    }
+
+    // A publish still holding the room only sees it empty
+    if (empty) {
+        shard.rooms.erase(it);
+    }
+    return removed;
+}
+
+size_t RoomIndex::room_count() const {
+    size_t count = 0;
+    for (const Shard& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.rooms_mutex);
+        count += shard.rooms.size();
+    }
+    return count;
+}
+
+bool parse_room_name(const std::string& text, std::string& room) {
+    size_t start = (!text.empty() && text[0] == '#') ? 1 : 0;
+    size_t length = text.size() - start;
+    if (length == 0 || length > ROOM_NAME_MAX_LEN) {
+        return false;
+    }
+
+    for (size_t i = start; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (!std::isgraph(c)) {
+            return false;
+        }
+    }
+
+    room = text.substr(start);
+    return true;
+}
+
+bool split_room_payload(const char* payload, std::string& room, std::string& text) {
+    std::string raw(payload);
+    size_t space = raw.find(' ');
+    if (!parse_room_name(raw.substr(0, space), room)) {
+        return false;
+    }
+    text = (space == std::string::npos) ? std::string() : raw.substr(space + 1);
+    return true;
+}
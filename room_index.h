@@ -0,0 +1,88 @@
+#ifndef ROOM_INDEX_H
+#define ROOM_INDEX_H
+
+#include "common.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+// Everything a publish needs to reach one subscriber without the client table
+struct RoomMember {
+    int socket_fd;
+    std::string user_id;
+    uint8_t protocol_version;
+    int shard;
+    std::shared_ptr<OutboundQueue> outbound;
+};
+
+/**
+ * Sharded room -> subscribers index
+ * Rooms are spread over shards by name hash. Join and leave lock the room's
+ * shard and then the room; a publish only looks the room up under a shared
+ * shard lock and visits members under that room's own lock, so traffic in
+ * one room never waits on another room or on the global client table.
+ */
+class RoomIndex {
+private:
+    struct Room {
+        std::mutex members_mutex;
+        std::vector<RoomMember> members;
+    };
+
+    struct Shard {
+        mutable std::shared_mutex rooms_mutex;
+        std::unordered_map<std::string, std::shared_ptr<Room>> rooms;
+    };
+
+    std::vector<Shard> shards;
+
+    Shard& shard_for(const std::string& room);
+    std::shared_ptr<Room> find(const std::string& room);
+    static bool contains(const std::vector<RoomMember>& members, int socket_fd);
+
+public:
+    explicit RoomIndex(size_t shard_count = ROOM_INDEX_SHARDS);
+
+    // Delete copy constructor and assignment operator
+    RoomIndex(const RoomIndex&) = delete;
+    RoomIndex& operator=(const RoomIndex&) = delete;
+
+    // False if the socket is already a member
+    bool join(const std::string& room, const RoomMember& member);
+
+    // False if the socket was not a member; empty rooms are removed
+    bool leave(const std::string& room, int socket_fd);
+
+    // Call visitor on every member under the room's lock. With a sender the
+    // publish is refused (returns false) unless the sender is a member.
+    template <typename Visitor>
+    bool publish(const std::string& room, int sender_socket, Visitor&& visitor) {
+        std::shared_ptr<Room> target = find(room);
+        if (!target) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(target->members_mutex);
+        if (sender_socket >= 0 && !contains(target->members, sender_socket)) {
+            return false;
+        }
+        for (const RoomMember& member : target->members) {
+            visitor(member);
+        }
+        return true;
+    }
+
+    size_t room_count() const;
+};
+
+// Room names are 1..ROOM_NAME_MAX_LEN printable characters without spaces;
+// a leading '#' is accepted and stripped
+bool parse_room_name(const std::string& text, std::string& room);
+
+// Room messages carry "<room> <text>" in the payload; false if malformed
+bool split_room_payload(const char* payload, std::string& room, std::string& text);
+
+#endif
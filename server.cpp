@@ -2,15 +2,23 @@
 #include "thread_pool.h"
 #include "cache.h"
 #include "scheduler.h"
+#include "reactor.h"
+#include "uring_loop.h"
+#include "protocol.h"
+#include "frame_reader.h"
+#include "outbound_queue.h"
+#include "room_index.h"
+#include "client_registry.h"
+#include "logger.h"
 #include <iostream>
 #include <iomanip>
 #include <cstring>
 #include <unistd.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <vector>
-#include <map>
 #include <mutex>
 #include <fstream>
 #include <sstream>
@@ -19,40 +27,76 @@
 #include <chrono>
 #include <thread>
 #include <atomic>
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <pthread.h>
+#include <sched.h>
 
 // Global variables
-std::map<int, ClientInfo> clients;
-std::mutex clients_mutex;
+ClientRegistry clients;
 MessageCache message_cache(CACHE_SIZE);
+RoomIndex room_index;
 RoundRobinScheduler scheduler;
 PerformanceMetrics metrics;
 std::mutex metrics_mutex;
 std::atomic<bool> server_running(true);
-std::ofstream log_file;
+Logger logger;
+UringLoop* uring_loop = nullptr;  // Set while the io_uring backend is serving
+Reactor* reactor = nullptr;       // Set while the epoll backend is serving
+std::vector<Reactor*> shards;     // Per-core event loops in sharded mode
+thread_local int current_shard = -1;  // Index into shards for the calling loop thread
+int shard_count = 0;              // 0: one shard per core
+SlowConsumerPolicy slow_consumer_policy = SlowConsumerPolicy::DROP_OLDEST;
+size_t outbound_queue_limit = OUTBOUND_QUEUE_LIMIT;
+ThreadPoolMode pool_mode = ThreadPoolMode::SHARED_QUEUE;
+int pool_max_size = 0;                 // Above THREAD_POOL_SIZE: the pool may grow this far
+ThreadPool* worker_pool = nullptr;     // Set while main's pool exists, for statistics
+std::atomic<uint32_t> next_sequence(1);
+
+// I/O model used to serve client connections
+enum class ServerMode {
+    THREADED,  // One pool worker per connection, blocking sockets
+    EPOLL,     // Edge-triggered reactor, workers handle readiness events
+    URING,     // io_uring ring thread with batched submissions
+    SHARDED    // One SO_REUSEPORT listener and inline reactor per core
+};
 
 // Function prototypes
 void handle_client(int client_socket);
+bool register_client(int client_socket, const std::string& user_id, uint8_t protocol_version);
+void process_message(int client_socket, const std::string& user_id, Message& msg);
+void unregister_client(int client_socket, const std::string& user_id);
+bool flush_outbound(const std::shared_ptr<OutboundQueue>& queue, int shard);
+void flush_client(int client_socket);
 void broadcast_message(const Message& msg, int sender_socket);
+bool publish_to_room(const std::string& room, const Message& msg, int sender_socket);
+Message make_room_message(uint8_t type, const std::string& sender, const std::string& room,
+                          const std::string& text);
+void join_room(int client_socket, const std::string& user_id, const std::string& room);
+void leave_room(int client_socket, const std::string& user_id, const std::string& room);
 void log_message(const std::string& message);
+void log_message(LogLevel level, const std::string& message);
 void update_metrics();
 void read_page_faults();
 void signal_handler(int signum);
 void print_statistics();
 bool setup_server_socket(int& server_socket);
 void cleanup_server(int server_socket);
+void run_threaded(int server_socket, ThreadPool& thread_pool);
+void run_reactor(int server_socket, ThreadPool& thread_pool);
+void run_uring(int server_socket, ThreadPool& thread_pool);
+void run_sharded(int server_socket);
+ReactorHandlers make_handlers();
+bool parse_mode(const std::string& arg, ServerMode& mode);
+bool parse_args(int argc, char* argv[], ServerMode& mode);
 
 void log_message(const std::string& message) {
-    time_t now = time(nullptr);
-    char timestamp[64];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", localtime(&now));
-    
-    std::string log_entry = std::string(timestamp) + " - " + message;
-    std::cout << log_entry << std::endl;
-    
-    if (log_file.is_open()) {
-        log_file << log_entry << std::endl;
-        log_file.flush();
-    }
+    logger.log(LogLevel::INFO, message);
+}
+
+void log_message(LogLevel level, const std::string& message) {
+    logger.log(level, message);
 }
 
 void read_page_faults() {
@@ -75,57 +119,447 @@ void read_page_faults() {
 }
 
 void update_metrics() {
-    std::lock_guard<std::mutex> lock(metrics_mutex);
-    
+    // Gather client state before taking metrics_mutex
+    int active_clients;
+    uint64_t queued = 0;
+    uint64_t high_water = 0;
     {
-        std::lock_guard<std::mutex> clients_lock(clients_mutex);
-        metrics.active_clients = static_cast<int>(clients.size());
+        auto snapshot = clients.read();
+        active_clients = static_cast<int>(snapshot.size());
+        for (const auto& client_info : snapshot) {
+            if (client_info->outbound) {
+                queued += client_info->outbound->depth();
+                high_water = std::max<uint64_t>(high_water, client_info->outbound->get_high_water());
+            }
+        }
     }
     
-    metrics.cache_hits = message_cache.get_hits();
-    metrics.cache_misses = message_cache.get_misses();
+    {
+        std::lock_guard<std::mutex> lock(metrics_mutex);
+        metrics.active_clients = active_clients;
+        metrics.outbound_queued = queued;
+        metrics.outbound_high_water = std::max(metrics.outbound_high_water, high_water);
+        metrics.cache_hits = message_cache.get_hits();
+        metrics.cache_misses = message_cache.get_misses();
+    }
     
+    // Takes metrics_mutex itself
     read_page_faults();
 }
 
-void broadcast_message(const Message& msg, int sender_socket) {
-    std::vector<int> failed_sockets;
+// Push queued frames toward the socket without blocking the caller; whatever
+// does not fit is finished by the backend once the socket is writable
+bool flush_outbound(const std::shared_ptr<OutboundQueue>& queue, int shard) {
+    // The io_uring backend drains queues on its ring thread
+    if (uring_loop) {
+        uring_loop->flush(queue);
+        return true;
+    }
     
+    // Sharded mode: the shard that accepted a socket writes to it; other
+    // threads post to its mailbox, with at most one request pending per queue.
+    // If the owner falls behind and the queue is half full, the caller writes
+    // itself (the queue serialises writers) rather than let frames drop.
+    bool sharded = shard >= 0 && static_cast<size_t>(shard) < shards.size();
+    if (sharded && shard != current_shard && queue->depth() < outbound_queue_limit / 2) {
+        if (queue->schedule_flush()) {
+            shards[shard]->post([queue, shard]() {
+                queue->begin_scheduled_flush();
+                flush_outbound(queue, shard);
+            });
+        }
+        return true;
+    }
+    
+    Reactor* loop = sharded ? shards[shard] : reactor;
+    FlushResult result = queue->flush();
+    if (result == FlushResult::PENDING && loop) {
+        loop->watch_writable(queue->get_fd());
+    }
+    // In threaded mode the client's own handler thread polls for POLLOUT
+    return result != FlushResult::FAILED;
+}
+
+void flush_client(int client_socket) {
+    std::shared_ptr<OutboundQueue> queue;
+    int shard = -1;
     {
-        std::lock_guard<std::mutex> lock(clients_mutex);
+        auto snapshot = clients.read();
+        if (ClientInfo* client_info = snapshot.find(client_socket)) {
+            queue = client_info->outbound;
+            shard = client_info->shard;
+        }
+    }
+    if (queue) {
+        flush_outbound(queue, shard);
+    }
+}
+
+// One message on its way to many clients. The payload is copied once and
+// shared by the cache and every framed recipient; only a small head is
+// encoded per wire format in use. Frames are queued under whatever lock
+// guards the recipient list, then finish() flushes outside it.
+struct Fanout {
+    const Message& msg;
+    SharedPayload payload;
+    WireFrame encoded[PROTOCOL_VERSION + 1];
+    uint32_t sequence;
+    std::vector<std::pair<std::shared_ptr<OutboundQueue>, int>> recipients;
+    std::vector<std::string> slow_consumers;
+    uint64_t queued;
+    uint64_t dropped;
+    
+    explicit Fanout(const Message& message)
+        : msg(message), payload(share_payload(message)),
+          sequence(next_sequence.fetch_add(1)), queued(0), dropped(0) {}
+    
+    // Returns false if the queue overflowed and its connection is going away
+    bool push(const std::shared_ptr<OutboundQueue>& queue, uint8_t version, int shard,
+              const std::string& user_id) {
+        WireFrame& frame = encoded[version];
+        if (!frame.head) {
+            frame = encode_frame(msg, version, sequence, payload);
+        }
         
-        for (auto& [socket_fd, client_info] : clients) {
-            if (socket_fd != sender_socket && client_info.active) {
-                ssize_t sent = send(socket_fd, &msg, sizeof(Message), MSG_NOSIGNAL);
-                if (sent > 0) {
-                    std::lock_guard<std::mutex> metrics_lock(metrics_mutex);
-                    metrics.messages_sent++;
-                } else {
-                    // Mark for cleanup
-                    failed_sockets.push_back(socket_fd);
-                }
+        switch (queue->push(frame)) {
+            case EnqueueResult::QUEUED:
+                queued++;
+                break;
+            case EnqueueResult::DROPPED_OLDEST:
+                queued++;
+                dropped++;
+                break;
+            case EnqueueResult::DROPPED_NEWEST:
+                dropped++;
+                break;
+            case EnqueueResult::OVERFLOW:
+                // The queue already shut the socket down; its handler will unregister it
+                slow_consumers.push_back(user_id);
+                return false;
+            case EnqueueResult::CLOSED:
+                return true;
+        }
+        recipients.emplace_back(queue, shard);
+        return true;
+    }
+    
+    void finish() {
+        std::vector<std::shared_ptr<OutboundQueue>> failed_queues;
+        
+        {
+            std::lock_guard<std::mutex> metrics_lock(metrics_mutex);
+            metrics.messages_sent += queued;
+            metrics.messages_dropped += dropped;
+            metrics.slow_consumer_disconnects += slow_consumers.size();
+        }
+        
+        for (auto& [queue, shard] : recipients) {
+            if (!flush_outbound(queue, shard)) {
+                failed_queues.push_back(queue);
+            }
+        }
+        
+        for (const std::string& user_id : slow_consumers) {
+            log_message(LogLevel::WARN, "Slow consumer disconnected: " + user_id);
+        }
+        
+        // Mark failed connections for cleanup
+        for (auto& queue : failed_queues) {
+            std::shared_ptr<ClientInfo> client_info = clients.find(queue->get_fd());
+            if (client_info && client_info->outbound == queue && client_info->active.exchange(false)) {
+                log_message(LogLevel::WARN, "Client connection lost: " + client_info->user_id);
             }
         }
     }
+};
+
+void broadcast_message(const Message& msg, int sender_socket) {
+    Fanout fanout(msg);
     
-    // Clean up failed connections (do this outside the clients lock)
-    for (int fd : failed_sockets) {
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        auto it = clients.find(fd);
-        if (it != clients.end()) {
-            log_message("Client connection lost: " + it->second.user_id);
-            it->second.active = false;
+    {
+        // Lock-free walk of the current snapshot; joins and leaves publish a
+        // new one instead of waiting for broadcasts to finish
+        auto snapshot = clients.read();
+        
+        for (const auto& client_info : snapshot) {
+            if (client_info->socket_fd == sender_socket || !client_info->outbound ||
+                !client_info->active.load(std::memory_order_relaxed)) {
+                continue;
+            }
+            if (!fanout.push(client_info->outbound, client_info->protocol_version,
+                             client_info->shard, client_info->user_id)) {
+                client_info->active.store(false, std::memory_order_relaxed);
+            }
         }
     }
     
+    fanout.finish();
+    
     // Add message to cache
-    message_cache.insert(msg.sender, msg.payload, msg.timestamp);
+    message_cache.insert(msg.sender, fanout.payload, msg.timestamp);
+}
+
+bool publish_to_room(const std::string& room, const Message& msg, int sender_socket) {
+    Fanout fanout(msg);
+    
+    // Only the room's own lock is held while queueing
+    bool published = room_index.publish(room, sender_socket, [&](const RoomMember& member) {
+        if (member.socket_fd != sender_socket) {
+            fanout.push(member.outbound, member.protocol_version, member.shard, member.user_id);
+        }
+    });
+    
+    fanout.finish();
+    
+    if (published) {
+        message_cache.insert(msg.sender, fanout.payload, msg.timestamp);
+    }
+    return published;
+}
+
+// Build a room notice or message; the room always leads the payload
+Message make_room_message(uint8_t type, const std::string& sender, const std::string& room,
+                          const std::string& text) {
+    Message msg;
+    msg.type = type;
+    msg.timestamp = time(nullptr);
+    msg.set_sender(sender);
+    msg.set_payload(room + " " + text);
+    return msg;
+}
+
+void join_room(int client_socket, const std::string& user_id, const std::string& room) {
+    std::shared_ptr<ClientInfo> client_info = clients.find(client_socket);
+    if (!client_info || !client_info->outbound) {
+        return;
+    }
+    
+    std::vector<std::string>& joined = client_info->rooms;
+    if (std::find(joined.begin(), joined.end(), room) != joined.end()) {
+        return;
+    }
+    if (joined.size() >= MAX_ROOMS_PER_CLIENT) {
+        log_message(LogLevel::WARN, "Room limit reached for " + user_id + ", not joining #" + room);
+        return;
+    }
+    joined.push_back(room);
+    
+    RoomMember member;
+    member.socket_fd = client_socket;
+    member.user_id = user_id;
+    member.protocol_version = client_info->protocol_version;
+    member.shard = client_info->shard;
+    member.outbound = client_info->outbound;
+    room_index.join(room, member);
+    
+    // Everyone in the room hears about it, the new member included
+    publish_to_room(room, make_room_message(MSG_ROOM_JOIN, user_id, room, user_id + " has joined"), -1);
+    log_message(user_id + " joined #" + room);
+}
+
+void leave_room(int client_socket, const std::string& user_id, const std::string& room) {
+    std::shared_ptr<ClientInfo> client_info = clients.find(client_socket);
+    if (!client_info) {
+        return;
+    }
+    
+    std::vector<std::string>& joined = client_info->rooms;
+    auto pos = std::find(joined.begin(), joined.end(), room);
+    if (pos == joined.end()) {
+        return;
+    }
+    joined.erase(pos);
+    
+    // Notify while still a member so the leaver gets confirmation too
+    publish_to_room(room, make_room_message(MSG_ROOM_LEAVE, user_id, room, user_id + " has left"), -1);
+    room_index.leave(room, client_socket);
+    log_message(user_id + " left #" + room);
+}
+
+bool register_client(int client_socket, const std::string& user_id, uint8_t protocol_version) {
+    // Validate user ID
+    if (user_id.empty() || user_id.length() > USERNAME_MAX_LEN) {
+        log_message(LogLevel::WARN, "Invalid user ID received, disconnecting");
+        return false;
+    }
+    
+    // Queue the acknowledgement before the client is visible to any broadcast
+    auto outbound = std::make_shared<OutboundQueue>(client_socket, outbound_queue_limit,
+                                                    slow_consumer_policy);
+    if (protocol_version != PROTOCOL_LEGACY) {
+        WireFrame ack;
+        ack.head = std::make_shared<std::vector<char>>(encode_hello_ack(protocol_version));
+        outbound->push(std::move(ack));
+        if (!flush_outbound(outbound, current_shard)) {
+            return false;
+        }
+    }
+    
+    // Register client
+    {
+        auto info = std::make_shared<ClientInfo>();
+        info->socket_fd = client_socket;
+        info->user_id = user_id;
+        info->connect_time = time(nullptr);
+        info->last_active = time(nullptr);
+        info->active = true;
+        info->protocol_version = protocol_version;
+        info->outbound = outbound;
+        info->shard = current_shard;
+        clients.add(std::move(info));
+        
+        std::lock_guard<std::mutex> metrics_lock(metrics_mutex);
+        metrics.active_clients++;
+    }
+    
+    // Add to scheduler
+    scheduler.add_client(client_socket, user_id);
+    
+    // Send join notification
+    Message join_msg;
+    join_msg.type = MSG_JOIN;
+    join_msg.timestamp = time(nullptr);
+    join_msg.set_sender(user_id);
+    snprintf(join_msg.payload, sizeof(join_msg.payload), "%s has joined the chat", user_id.c_str());
+    join_msg.payload_size = strlen(join_msg.payload);
+    broadcast_message(join_msg, client_socket);
+    
+    log_message("Client connected: " + user_id + " (fd: " + std::to_string(client_socket) + ", protocol v" +
+                std::to_string(protocol_version) + ")");
+    return true;
+}
+
+void process_message(int client_socket, const std::string& user_id, Message& msg) {
+    {
+        std::lock_guard<std::mutex> metrics_lock(metrics_mutex);
+        metrics.messages_received++;
+    }
+    
+    // Update last active time
+    {
+        auto snapshot = clients.read();
+        if (ClientInfo* client_info = snapshot.find(client_socket)) {
+            client_info->last_active.store(time(nullptr), std::memory_order_relaxed);
+        }
+    }
+    
+    // Process message based on type
+    switch (msg.type) {
+        case MSG_TEXT: {
+            // Ensure null-terminated strings; framed clients may omit the sender
+            msg.set_sender(user_id);
+            msg.payload[sizeof(msg.payload) - 1] = '\0';
+            
+            time_t sent_at = msg.timestamp;
+            msg.timestamp = time(nullptr);
+            broadcast_message(msg, client_socket);
+            if (logger.sample()) {
+                log_message("Message from " + user_id + ": " + std::string(msg.payload));
+            }
+            
+            // Check cache for recent messages from same user (simulates
+            // deduplication), and simulate cache hits by looking up recently
+            // sent messages, all in one batch
+            MessageKey recent[] = {MessageKey(msg.sender, sent_at - 5), MessageKey(user_id, msg.timestamp - 1),
+                                   MessageKey(user_id, msg.timestamp - 2), MessageKey(user_id, msg.timestamp - 3)};
+            CachedContent found[4];
+            message_cache.lookup_many(recent, 4, found);
+            if (found[1] || found[2] || found[3]) {
+                // Touching a key that missed is a no-op
+                message_cache.touch_many(recent + 1, 3);
+            }
+            break;
+        }
+        
+        case MSG_ROOM_JOIN:
+        case MSG_ROOM_LEAVE: {
+            msg.payload[sizeof(msg.payload) - 1] = '\0';
+            std::string room;
+            if (!parse_room_name(msg.payload, room)) {
+                log_message(LogLevel::WARN, "Invalid room name from " + user_id);
+                break;
+            }
+            if (msg.type == MSG_ROOM_JOIN) {
+                join_room(client_socket, user_id, room);
+            } else {
+                leave_room(client_socket, user_id, room);
+            }
+            break;
+        }
+        
+        case MSG_ROOM_TEXT: {
+            msg.set_sender(user_id);
+            msg.payload[sizeof(msg.payload) - 1] = '\0';
+            std::string room;
+            std::string text;
+            if (!split_room_payload(msg.payload, room, text) || text.empty()) {
+                log_message(LogLevel::WARN, "Malformed room message from " + user_id);
+                break;
+            }
+            
+            // Normalise the room prefix ("#lobby" -> "lobby") for receivers
+            Message out = make_room_message(MSG_ROOM_TEXT, user_id, room, text);
+            if (!publish_to_room(room, out, client_socket)) {
+                log_message(LogLevel::WARN, user_id + " is not in #" + room + ", message dropped");
+                break;
+            }
+            if (logger.sample()) {
+                log_message("Message from " + user_id + " to #" + room + ": " + text);
+            }
+            break;
+        }
+            
+        default:
+            log_message(LogLevel::WARN, "Unknown message type " + std::to_string(msg.type) + 
+                        " from " + user_id);
+            break;
+    }
+}
+
+void unregister_client(int client_socket, const std::string& user_id) {
+    scheduler.remove_client(client_socket);
+    std::vector<std::string> joined;
+    
+    // Broadcasters may still hold the old snapshot; closing the queue keeps
+    // them from writing to the fd, which the caller closes next
+    std::shared_ptr<ClientInfo> client_info = clients.remove(client_socket);
+    {
+        std::lock_guard<std::mutex> metrics_lock(metrics_mutex);
+        if (client_info && client_info->outbound) {
+            client_info->outbound->close();
+            metrics.outbound_high_water = std::max<uint64_t>(metrics.outbound_high_water,
+                                                             client_info->outbound->get_high_water());
+        }
+        if (metrics.active_clients > 0) {
+            metrics.active_clients--;
+        }
+    }
+    if (client_info) {
+        joined.swap(client_info->rooms);
+    }
+    
+    // Send leave notification
+    Message leave_msg;
+    leave_msg.type = MSG_LEAVE;
+    leave_msg.timestamp = time(nullptr);
+    leave_msg.set_sender(user_id);
+    snprintf(leave_msg.payload, sizeof(leave_msg.payload), "%s has left the chat", user_id.c_str());
+    leave_msg.payload_size = strlen(leave_msg.payload);
+    broadcast_message(leave_msg, -1);
+    
+    for (const std::string& room : joined) {
+        room_index.leave(room, client_socket);
+        publish_to_room(room, make_room_message(MSG_ROOM_LEAVE, user_id, room, user_id + " has left"), -1);
+    }
+    
+    log_message("Client disconnected: " + user_id + " (fd: " + std::to_string(client_socket) + ")");
 }
 
 void handle_client(int client_socket) {
-    char buffer[BUFFER_SIZE];
     Message msg;
     std::string user_id;
+    uint8_t protocol_version = PROTOCOL_LEGACY;
+    bool registered = false;
     
     try {
         // Set socket timeout to allow checking server_running
@@ -133,65 +567,73 @@ void handle_client(int client_socket) {
         tv.tv_sec = 1;  // 1 second timeout for faster shutdown
         tv.tv_usec = 0;
         if (setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
-            log_message("Warning: Failed to set socket timeout");
+            log_message(LogLevel::WARN, "Warning: Failed to set socket timeout");
         }
         
-        // Receive initial user ID
-        memset(buffer, 0, sizeof(buffer));
-        ssize_t bytes = recv(client_socket, buffer, BUFFER_SIZE - 1, 0);
-        if (bytes <= 0) {
-            close(client_socket);
-            return;
+        // Receive initial user ID and protocol hello. It goes through the same
+        // ring as the messages, so it may be split across reads or share one
+        // with the first frames; a bare legacy name ends where the client paused
+        FrameReader reader;
+        DecodeStatus hello_status = DecodeStatus::INCOMPLETE;
+        while (hello_status == DecodeStatus::INCOMPLETE) {
+            ssize_t bytes = reader.fill(client_socket);
+            if (bytes < 0 && errno == EINTR) {
+                continue;
+            }
+            if (bytes <= 0) {
+                close(client_socket);
+                return;
+            }
+            // Take whatever else is already waiting before judging the hello
+            while (reader.fill(client_socket, MSG_DONTWAIT) > 0) {
+            }
+            hello_status = reader.hello(user_id, protocol_version, true);
         }
         
-        buffer[std::min(bytes, (ssize_t)(BUFFER_SIZE - 1))] = '\0';
-        user_id = std::string(buffer);
-        
-        // Validate user ID
-        if (user_id.empty() || user_id.length() > USERNAME_MAX_LEN) {
-            log_message("Invalid user ID received, disconnecting");
+        if (hello_status == DecodeStatus::INVALID || !register_client(client_socket, user_id, protocol_version)) {
             close(client_socket);
             return;
         }
+        registered = true;
         
-        // Register client
-        {
-            std::lock_guard<std::mutex> lock(clients_mutex);
-            ClientInfo info;
-            info.socket_fd = client_socket;
-            info.user_id = user_id;
-            info.connect_time = time(nullptr);
-            info.last_active = time(nullptr);
-            info.active = true;
-            clients[client_socket] = info;
-            
-            std::lock_guard<std::mutex> metrics_lock(metrics_mutex);
-            metrics.active_clients++;
+        std::shared_ptr<OutboundQueue> outbound;
+        if (std::shared_ptr<ClientInfo> client_info = clients.find(client_socket)) {
+            outbound = client_info->outbound;
         }
         
-        // Add to scheduler
-        scheduler.add_client(client_socket, user_id);
-        
-        // Send join notification
-        Message join_msg;
-        memset(&join_msg, 0, sizeof(join_msg));
-        join_msg.type = MSG_JOIN;
-        join_msg.timestamp = time(nullptr);
-        join_msg.set_sender(user_id);
-        snprintf(join_msg.payload, sizeof(join_msg.payload), "%s has joined the chat", user_id.c_str());
-        join_msg.payload_size = strlen(join_msg.payload);
-        broadcast_message(join_msg, client_socket);
-        
-        log_message("Client connected: " + user_id + " (fd: " + std::to_string(client_socket) + ")");
-        
-        // Main message loop
-        while (server_running.load()) {
-            memset(&msg, 0, sizeof(msg));
-            bytes = recv(client_socket, &msg, sizeof(Message), 0);
+        // Main message loop: each recv takes whatever is available and every
+        // complete message in it is processed; a partial tail waits for more.
+        // Frames a broadcaster could not write are flushed here on POLLOUT.
+        // Anything that came in with the hello goes first.
+        DecodeStatus status;
+        while ((status = reader.next(msg)) == DecodeStatus::COMPLETE) {
+            process_message(client_socket, user_id, msg);
+        }
+        while (status != DecodeStatus::INVALID && server_running.load()) {
+            struct pollfd pfd;
+            pfd.fd = client_socket;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if (outbound && outbound->depth() > 0) {
+                pfd.events |= POLLOUT;
+            }
+            
+            if (poll(&pfd, 1, EPOLL_TIMEOUT_MS) <= 0) {
+                // Timeout or signal - continue loop to check server_running
+                continue;
+            }
+            if ((pfd.revents & POLLOUT) && outbound->flush() == FlushResult::FAILED) {
+                break;
+            }
+            if (!(pfd.revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            
+            ssize_t bytes = reader.fill(client_socket);
             
             if (bytes < 0) {
                 // Check if it was a timeout
-                if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                if (errno == EWOULDBLOCK || errno == EAGAIN || errno == EINTR) {
                     // Timeout - continue loop to check server_running
                     continue;
                 }
@@ -199,87 +641,25 @@ void handle_client(int client_socket) {
                 break;
             }
             
-            if (bytes == 0 || bytes != sizeof(Message)) {
-                // Client disconnected or invalid message
+            if (bytes == 0) {
+                // Client disconnected
                 break;
             }
             
-            {
-                std::lock_guard<std::mutex> metrics_lock(metrics_mutex);
-                metrics.messages_received++;
-            }
-            
-            // Update last active time
-            {
-                std::lock_guard<std::mutex> lock(clients_mutex);
-                auto it = clients.find(client_socket);
-                if (it != clients.end()) {
-                    it->second.last_active = time(nullptr);
-                }
-            }
-            
-            // Process message based on type
-            switch (msg.type) {
-                case MSG_TEXT: {
-                    // Ensure null-terminated strings
-                    msg.sender[sizeof(msg.sender) - 1] = '\0';
-                    msg.payload[sizeof(msg.payload) - 1] = '\0';
-                    
-                    // Check cache for recent messages from same user (simulates deduplication)
-                    std::string recent_msg_id = std::string(msg.sender) + "_" + 
-                                                std::to_string(msg.timestamp - 5);
-                    std::string cached;
-                    message_cache.lookup(recent_msg_id, cached);
-                    
-                    msg.timestamp = time(nullptr);
-                    broadcast_message(msg, client_socket);
-                    log_message("Message from " + user_id + ": " + std::string(msg.payload));
-                    
-                    // Simulate cache hits by looking up recently sent messages
-                    for (int i = 1; i <= 3; i++) {
-                        std::string prev_msg_id = user_id + "_" + std::to_string(msg.timestamp - i);
-                        std::string cached_msg;
-                        if (message_cache.lookup(prev_msg_id, cached_msg)) {
-                            message_cache.update_access(prev_msg_id);
-                        }
-                    }
-                    break;
-                }
-                    
-                default:
-                    log_message("Unknown message type " + std::to_string(msg.type) + 
-                                " from " + user_id);
-                    break;
+            while ((status = reader.next(msg)) == DecodeStatus::COMPLETE) {
+                process_message(client_socket, user_id, msg);
             }
         }
+        if (status == DecodeStatus::INVALID) {
+            log_message(LogLevel::WARN, "Malformed frame from " + user_id + ", disconnecting");
+        }
     } catch (const std::exception& e) {
-        log_message("Exception in handle_client: " + std::string(e.what()));
+        log_message(LogLevel::ERROR, "Exception in handle_client: " + std::string(e.what()));
     }
     
     // Client cleanup
-    scheduler.remove_client(client_socket);
-    
-    {
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        clients.erase(client_socket);
-        std::lock_guard<std::mutex> metrics_lock(metrics_mutex);
-        if (metrics.active_clients > 0) {
-            metrics.active_clients--;
-        }
-    }
-    
-    // Send leave notification if we have a user_id
-    if (!user_id.empty()) {
-        Message leave_msg;
-        memset(&leave_msg, 0, sizeof(leave_msg));
-        leave_msg.type = MSG_LEAVE;
-        leave_msg.timestamp = time(nullptr);
-        leave_msg.set_sender(user_id);
-        snprintf(leave_msg.payload, sizeof(leave_msg.payload), "%s has left the chat", user_id.c_str());
-        leave_msg.payload_size = strlen(leave_msg.payload);
-        broadcast_message(leave_msg, -1);
-        
-        log_message("Client disconnected: " + user_id + " (fd: " + std::to_string(client_socket) + ")");
+    if (registered) {
+        unregister_client(client_socket, user_id);
     }
     
     close(client_socket);
@@ -292,12 +672,39 @@ void print_statistics() {
     std::cout << "Messages Sent:     " << metrics.messages_sent << std::endl;
     std::cout << "Messages Received: " << metrics.messages_received << std::endl;
     std::cout << "Active Clients:    " << metrics.active_clients << std::endl;
+    std::cout << "Active Rooms:      " << room_index.room_count() << std::endl;
+    std::cout << "Messages Dropped:  " << metrics.messages_dropped << std::endl;
+    std::cout << "Slow Disconnects:  " << metrics.slow_consumer_disconnects << std::endl;
+    std::cout << "Queued Frames:     " << metrics.outbound_queued << " (peak per client: "
+              << metrics.outbound_high_water << ")" << std::endl;
+    std::cout << "Log Records Lost:  " << logger.get_dropped() << std::endl;
+    if (worker_pool && worker_pool->is_elastic()) {
+        std::cout << "Pool Workers:      " << worker_pool->get_pool_size() << " (" << worker_pool->get_min_size()
+                  << "-" << worker_pool->get_max_size() << ", grew " << worker_pool->get_grow_count()
+                  << ", retired " << worker_pool->get_shrink_count() << ")" << std::endl;
+    }
     std::cout << "Cache Hits:        " << metrics.cache_hits << std::endl;
     std::cout << "Cache Misses:      " << metrics.cache_misses << std::endl;
     std::cout << "Cache Hit Rate:    " << std::fixed << std::setprecision(2) 
               << message_cache.get_hit_rate() << "%" << std::endl;
     std::cout << "Cache Size:        " << message_cache.get_size() << "/" 
               << message_cache.get_capacity() << std::endl;
+    if (message_cache.get_default_ttl() > 0) {
+        std::cout << "Cache Expired:     " << message_cache.get_expired() << " (TTL "
+                  << message_cache.get_default_ttl() << "s)" << std::endl;
+    }
+    if (message_cache.has_negative_filter()) {
+        std::cout << "Cache Filter:      " << message_cache.get_filtered() << " misses filtered, "
+                  << message_cache.get_filter_false_positive_rate() << "% false positives ("
+                  << message_cache.get_filter_bytes() << " bytes)" << std::endl;
+    }
+    if (message_cache.get_byte_budget() > 0) {
+        CacheMemoryStats memory = message_cache.get_memory_stats();
+        std::cout << "Cache Memory:      " << memory.used_bytes << "/" << memory.budget_bytes
+                  << " bytes (" << memory.reserved_bytes << " in " << memory.slabs << " slabs)" << std::endl;
+        std::cout << "Cache Fragment.:   " << memory.internal_fragmentation() * 100.0 << "% rounding, "
+                  << memory.external_fragmentation() * 100.0 << "% free in slabs" << std::endl;
+    }
 }
 
 void signal_handler(int signum) {
@@ -317,19 +724,19 @@ bool setup_server_socket(int& server_socket) {
     // Create server socket
     server_socket = socket(AF_INET, SOCK_STREAM, 0);
     if (server_socket < 0) {
-        log_message("ERROR: Failed to create socket");
+        log_message(LogLevel::ERROR, "ERROR: Failed to create socket");
         return false;
     }
     
     // Set socket options
     int opt = 1;
     if (setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        log_message("WARNING: setsockopt SO_REUSEADDR failed");
+        log_message(LogLevel::WARN, "WARNING: setsockopt SO_REUSEADDR failed");
     }
     
     // Allow port reuse
     if (setsockopt(server_socket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
-        log_message("WARNING: setsockopt SO_REUSEPORT failed");
+        log_message(LogLevel::WARN, "WARNING: setsockopt SO_REUSEPORT failed");
     }
     
     // Bind socket
@@ -340,14 +747,14 @@ bool setup_server_socket(int& server_socket) {
     server_addr.sin_port = htons(SERVER_PORT);
     
     if (bind(server_socket, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        log_message("ERROR: Bind failed - port may be in use");
+        log_message(LogLevel::ERROR, "ERROR: Bind failed - port may be in use");
         close(server_socket);
         return false;
     }
     
     // Listen for connections
     if (listen(server_socket, MAX_CLIENTS) < 0) {
-        log_message("ERROR: Listen failed");
+        log_message(LogLevel::ERROR, "ERROR: Listen failed");
         close(server_socket);
         return false;
     }
@@ -362,112 +769,362 @@ void cleanup_server(int server_socket) {
     close(server_socket);
     
     // Force close all client connections to unblock threads
-    {
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        for (auto& [socket_fd, client_info] : clients) {
-            if (client_info.active) {
-                // Force immediate close without graceful shutdown
-                struct linger sl;
-                sl.l_onoff = 1;
-                sl.l_linger = 0;
-                setsockopt(socket_fd, SOL_SOCKET, SO_LINGER, &sl, sizeof(sl));
-                close(socket_fd);
-                client_info.active = false;
-            }
+    for (const auto& client_info : clients.clear()) {
+        if (client_info->outbound) {
+            client_info->outbound->close();
+        }
+        if (client_info->active.exchange(false)) {
+            // Force immediate close without graceful shutdown
+            struct linger sl;
+            sl.l_onoff = 1;
+            sl.l_linger = 0;
+            setsockopt(client_info->socket_fd, SOL_SOCKET, SO_LINGER, &sl, sizeof(sl));
+            close(client_info->socket_fd);
         }
-        clients.clear();
     }
     
     // Give threads a brief moment to detect closed sockets and exit
     std::cout << "Waiting for threads to finish..." << std::endl;
     std::this_thread::sleep_for(std::chrono::milliseconds(1000));
     
+    // Write out queued log lines so the statistics come last
+    logger.stop();
+    
     // Final statistics
+    update_metrics();
     print_statistics();
     
     log_message("Server shutdown complete");
+}
+
+void run_threaded(int server_socket, ThreadPool& thread_pool) {
+    // Main accept loop
+    while (server_running.load()) {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        
+        // Set socket to non-blocking for clean shutdown
+        struct timeval tv;
+        tv.tv_sec = 1;  // 1 second timeout
+        tv.tv_usec = 0;
+        setsockopt(server_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        
+        int client_socket = accept(server_socket, (struct sockaddr*)&client_addr, &client_len);
+        
+        if (client_socket < 0) {
+            if (!server_running.load()) {
+                // Shutting down
+                break;
+            }
+            if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                // Timeout, check if we should continue
+                continue;
+            }
+            log_message(LogLevel::ERROR, "ERROR: Accept failed: " + std::string(strerror(errno)));
+            continue;
+        }
+        
+        // Get client IP
+        char client_ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+        log_message("New connection from " + std::string(client_ip));
+        
+        // Assign to thread pool
+        try {
+            thread_pool.enqueue([client_socket]() {
+                handle_client(client_socket);
+            });
+            
+            {
+                std::lock_guard<std::mutex> lock(metrics_mutex);
+                metrics.active_threads = thread_pool.get_active_count();
+            }
+        } catch (const std::exception& e) {
+            log_message(LogLevel::ERROR, "ERROR: Failed to enqueue client: " + std::string(e.what()));
+            close(client_socket);
+        }
+    }
+}
+
+ReactorHandlers make_handlers() {
+    ReactorHandlers handlers;
+    handlers.on_accept = [](int, const std::string& client_ip) {
+        log_message("New connection from " + client_ip);
+    };
+    handlers.on_open = register_client;
+    handlers.on_message = process_message;
+    handlers.on_close = unregister_client;
+    handlers.on_writable = flush_client;
+    return handlers;
+}
+
+void run_reactor(int server_socket, ThreadPool& thread_pool) {
+    Reactor loop(server_socket, thread_pool, make_handlers());
     
-    if (log_file.is_open()) {
-        log_file.close();
+    // Broadcasts ask the reactor to finish writes a full socket buffer cut short
+    reactor = &loop;
+    loop.run(server_running);
+    reactor = nullptr;
+}
+
+void run_uring(int server_socket, ThreadPool& thread_pool) {
+    std::unique_ptr<UringLoop> loop;
+    try {
+        loop = std::make_unique<UringLoop>(server_socket, make_handlers());
+    } catch (const std::exception& e) {
+        log_message(LogLevel::WARN, "WARNING: io_uring unavailable (" + std::string(e.what()) + "), falling back to epoll");
+        run_reactor(server_socket, thread_pool);
+        return;
+    }
+    
+    // Handlers run on the ring thread, so broadcasts can queue sends directly
+    uring_loop = loop.get();
+    loop->run(server_running);
+    uring_loop = nullptr;
+}
+
+void run_sharded(int server_socket) {
+    unsigned cores = std::thread::hardware_concurrency();
+    if (cores == 0) {
+        cores = 1;
+    }
+    int count = shard_count > 0 ? shard_count : static_cast<int>(cores);
+    
+    // Shard 0 reuses the main listener; the kernel spreads new connections
+    // across every socket bound to the port with SO_REUSEPORT
+    std::vector<int> listeners{server_socket};
+    for (int i = 1; i < count; ++i) {
+        int listener;
+        if (!setup_server_socket(listener)) {
+            log_message(LogLevel::WARN, "WARNING: Could not open listener for shard " + std::to_string(i) +
+                        ", continuing with " + std::to_string(listeners.size()));
+            break;
+        }
+        listeners.push_back(listener);
+    }
+    
+    std::vector<std::unique_ptr<Reactor>> loops;
+    for (int listener : listeners) {
+        loops.push_back(std::make_unique<Reactor>(listener, make_handlers()));
+        shards.push_back(loops.back().get());
+    }
+    log_message("Started " + std::to_string(loops.size()) + " reactor shards");
+    
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < loops.size(); ++i) {
+        threads.emplace_back([i, cores, &loops]() {
+            current_shard = static_cast<int>(i);
+            
+            // Keep each shard and the connections it accepted on one core
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(i % cores, &cpus);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+                log_message(LogLevel::WARN, "WARNING: Could not pin shard " + std::to_string(i));
+            }
+            
+            loops[i]->run(server_running);
+        });
     }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    shards.clear();
+    for (size_t i = 1; i < listeners.size(); ++i) {
+        close(listeners[i]);
+    }
+}
+
+bool parse_mode(const std::string& arg, ServerMode& mode) {
+    if (arg == "--mode=threaded") {
+        mode = ServerMode::THREADED;
+    } else if (arg == "--mode=epoll") {
+        mode = ServerMode::EPOLL;
+    } else if (arg == "--mode=uring") {
+        mode = ServerMode::URING;
+    } else if (arg == "--mode=sharded") {
+        mode = ServerMode::SHARDED;
+    } else {
+        return false;
+    }
+    return true;
 }
 
-int main() {
+bool parse_args(int argc, char* argv[], ServerMode& mode) {
+    EvictionPolicyType cache_policy = EvictionPolicyType::LRU;
+    size_t cache_bytes = 0;
+    time_t cache_ttl = CACHE_DEFAULT_TTL;
+    bool cache_filter = false;
+    bool pool_options = false;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--mode=", 0) == 0) {
+            if (!parse_mode(arg, mode)) {
+                return false;
+            }
+        } else if (arg.rfind("--slow-consumer=", 0) == 0) {
+            if (!parse_slow_consumer_policy(arg.substr(16), slow_consumer_policy)) {
+                return false;
+            }
+        } else if (arg.rfind("--queue-limit=", 0) == 0) {
+            char* end = nullptr;
+            unsigned long limit = strtoul(arg.c_str() + 14, &end, 10);
+            if (end == arg.c_str() + 14 || *end != '\0' || limit == 0) {
+                return false;
+            }
+            outbound_queue_limit = limit;
+        } else if (arg.rfind("--log-level=", 0) == 0) {
+            LogLevel level;
+            if (!parse_log_level(arg.substr(12), level)) {
+                return false;
+            }
+            logger.set_level(level);
+        } else if (arg.rfind("--log-sample=", 0) == 0) {
+            char* end = nullptr;
+            unsigned long every = strtoul(arg.c_str() + 13, &end, 10);
+            if (end == arg.c_str() + 13 || *end != '\0' || every == 0 || every > UINT32_MAX) {
+                return false;
+            }
+            logger.set_sample_every(static_cast<uint32_t>(every));
+        } else if (arg.rfind("--cache-policy=", 0) == 0) {
+            if (!parse_eviction_policy(arg.substr(15), cache_policy)) {
+                return false;
+            }
+        } else if (arg.rfind("--cache-bytes=", 0) == 0) {
+            char* end = nullptr;
+            unsigned long long bytes = strtoull(arg.c_str() + 14, &end, 10);
+            if (end == arg.c_str() + 14 || *end != '\0' || bytes == 0) {
+                return false;
+            }
+            cache_bytes = static_cast<size_t>(bytes);
+        } else if (arg.rfind("--cache-ttl=", 0) == 0) {
+            char* end = nullptr;
+            long seconds = strtol(arg.c_str() + 12, &end, 10);
+            if (end == arg.c_str() + 12 || *end != '\0' || seconds < 0) {
+                return false;
+            }
+            cache_ttl = static_cast<time_t>(seconds);
+        } else if (arg == "--cache-filter=on" || arg == "--cache-filter=off") {
+            cache_filter = arg == "--cache-filter=on";
+        } else if (arg.rfind("--pool=", 0) == 0) {
+            if (!parse_thread_pool_mode(arg.substr(7), pool_mode)) {
+                return false;
+            }
+            pool_options = true;
+        } else if (arg.rfind("--pool-max=", 0) == 0) {
+            char* end = nullptr;
+            long count = strtol(arg.c_str() + 11, &end, 10);
+            if (end == arg.c_str() + 11 || *end != '\0' || count < THREAD_POOL_SIZE || count > MAX_CLIENTS) {
+                return false;
+            }
+            pool_max_size = static_cast<int>(count);
+            pool_options = true;
+        } else if (arg.rfind("--shards=", 0) == 0) {
+            char* end = nullptr;
+            long count = strtol(arg.c_str() + 9, &end, 10);
+            if (end == arg.c_str() + 9 || *end != '\0' || count <= 0 || count > MAX_CLIENTS) {
+                return false;
+            }
+            shard_count = static_cast<int>(count);
+        } else {
+            return false;
+        }
+    }
+    
+    // Sharded mode handles every client on its own reactor and has no pool
+    if (mode == ServerMode::SHARDED && pool_options) {
+        return false;
+    }
+    
+    // Nothing is running yet, so the cache can simply be replaced
+    try {
+        message_cache = cache_bytes > 0 ? MessageCache(CacheByteBudget{cache_bytes}, cache_policy)
+                                        : MessageCache(CACHE_SIZE, cache_policy);
+        message_cache.set_default_ttl(cache_ttl);
+        if (cache_filter) {
+            message_cache.enable_negative_filter();
+        }
+    } catch (const std::invalid_argument&) {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    ServerMode mode = ServerMode::EPOLL;
+    if (!parse_args(argc, argv, mode)) {
+        std::cerr << "Usage: " << argv[0] << " [--mode=epoll|uring|sharded|threaded] [--shards=N]"
+                  << " [--pool=shared|stealing] [--pool-max=N]"
+                  << " [--slow-consumer=drop-oldest|drop-newest|disconnect] [--queue-limit=N]"
+                  << " [--log-level=debug|info|warn|error|off] [--log-sample=N]"
+                  << " [--cache-policy=lru|clock|arc|tinylfu] [--cache-bytes=N] [--cache-ttl=SECONDS]"
+                  << " [--cache-filter=on|off]" << std::endl;
+        return 1;
+    }
+    
     // Setup signal handler
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
-    // Open log file
-    log_file.open("server.log", std::ios::app);
-    if (!log_file.is_open()) {
+    // Start the log writer thread and open the log file
+    if (!logger.start("server.log")) {
         std::cerr << "Warning: Could not open log file" << std::endl;
     }
     
     log_message("Server starting...");
     
+    // Expired messages leave the cache without waiting for a lookup
+    if (message_cache.get_default_ttl() > 0) {
+        message_cache.start_expiry();
+    }
+    
     try {
-        // Create thread pool
-        ThreadPool thread_pool(THREAD_POOL_SIZE);
+        // Create thread pool; sharded mode never hands work to one
+        std::unique_ptr<ThreadPool> thread_pool;
+        if (mode != ServerMode::SHARDED) {
+            thread_pool = std::make_unique<ThreadPool>(THREAD_POOL_SIZE, pool_mode, pool_max_size);
+            worker_pool = thread_pool.get();
+        }
         
         int server_socket;
         if (!setup_server_socket(server_socket)) {
             return 1;
         }
         
-        log_message("Server listening on port " + std::to_string(SERVER_PORT));
+        const char* mode_name = mode == ServerMode::EPOLL ? "epoll" :
+                                mode == ServerMode::URING ? "uring" :
+                                mode == ServerMode::SHARDED ? "sharded" : "threaded";
+        log_message("Server listening on port " + std::to_string(SERVER_PORT) +
+                    " (" + mode_name + " mode, slow consumers: " +
+                    slow_consumer_policy_name(slow_consumer_policy) + ", queue limit " +
+                    std::to_string(outbound_queue_limit) + ", cache policy " +
+                    message_cache.get_policy_name() +
+                    (message_cache.get_byte_budget() > 0
+                         ? ", cache budget " + std::to_string(message_cache.get_byte_budget()) + " bytes"
+                         : std::string()) +
+                    (message_cache.get_default_ttl() > 0
+                         ? ", cache TTL " + std::to_string(message_cache.get_default_ttl()) + "s"
+                         : std::string()) +
+                    (message_cache.has_negative_filter() ? ", cache filter on" : "") + ")");
         std::cout << "\nServer is running. Press Ctrl+C to stop.\n" << std::endl;
         
-        // Main accept loop
-        while (server_running.load()) {
-            struct sockaddr_in client_addr;
-            socklen_t client_len = sizeof(client_addr);
-            
-            // Set socket to non-blocking for clean shutdown
-            struct timeval tv;
-            tv.tv_sec = 1;  // 1 second timeout
-            tv.tv_usec = 0;
-            setsockopt(server_socket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-            
-            int client_socket = accept(server_socket, (struct sockaddr*)&client_addr, &client_len);
-            
-            if (client_socket < 0) {
-                if (!server_running.load()) {
-                    // Shutting down
-                    break;
-                }
-                if (errno == EWOULDBLOCK || errno == EAGAIN) {
-                    // Timeout, check if we should continue
-                    continue;
-                }
-                log_message("ERROR: Accept failed: " + std::string(strerror(errno)));
-                continue;
-            }
-            
-            // Get client IP
-            char client_ip[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
-            log_message("New connection from " + std::string(client_ip));
-            
-            // Assign to thread pool
-            try {
-                thread_pool.enqueue([client_socket]() {
-                    handle_client(client_socket);
-                });
-                
-                {
-                    std::lock_guard<std::mutex> lock(metrics_mutex);
-                    metrics.active_threads = thread_pool.get_active_count();
-                }
-            } catch (const std::exception& e) {
-                log_message("ERROR: Failed to enqueue client: " + std::string(e.what()));
-                close(client_socket);
-            }
+        if (mode == ServerMode::EPOLL) {
+            run_reactor(server_socket, *thread_pool);
+        } else if (mode == ServerMode::URING) {
+            run_uring(server_socket, *thread_pool);
+        } else if (mode == ServerMode::SHARDED) {
+            run_sharded(server_socket);
+        } else {
+            run_threaded(server_socket, *thread_pool);
         }
         
         cleanup_server(server_socket);
+        worker_pool = nullptr;
         
     } catch (const std::exception& e) {
-        log_message("FATAL ERROR: " + std::string(e.what()));
+        log_message(LogLevel::ERROR, "FATAL ERROR: " + std::string(e.what()));
         return 1;
     }
     
@@ -0,0 +1,174 @@
+#include "slab_arena.h"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+
+SlabArena::SlabArena(size_t slab_bytes)
+    : slab_size(slab_bytes), reserved_bytes(0), deferred_bytes(0), block_bytes(0), requested_bytes(0) {}
+
+size_t SlabArena::block_size_for(size_t bytes, size_t slab_bytes) {
+    // Classes step by 1.5x then 4/3x (64, 96, 128, 192, ...), so a block
+    // wastes at most a third of itself
+    size_t size = CACHE_MIN_BLOCK_SIZE;
+    while (size < bytes && size <= slab_bytes / 4) {
+        size = (size & (size - 1)) == 0 ? size + size / 2 : size + size / 3;
+        size = (size + 15) & ~size_t(15);
+    }
+    if (size < bytes) {
+        // Too big for a shared slab: a dedicated one of (almost) exactly its size
+        size = (bytes + 15) & ~size_t(15);
+    }
+    return size;
+}
+
+ArenaSlab* SlabArena::add_slab(size_t block_size) {
+    auto slab = std::make_shared<ArenaSlab>();
+    slab->block_size = block_size;
+    slab->block_count = block_size > slab_size / 4 ? 1 : slab_size / block_size;
+    slab->memory.reset(new char[slab->block_size * slab->block_count]);
+    slab->carved = 0;
+    slab->live = 0;
+    slab->shared = 0;
+    slab->in_partial = true;
+
+    reserved_bytes += slab->block_size * slab->block_count;
+    partial[block_size].push_back(slab.get());
+    const char* start = slab->memory.get();
+    return slabs.emplace(start, std::move(slab)).first->second.get();
+}
+
+ArenaSlab* SlabArena::slab_of(const void* data) const {
+    // The last slab starting at or before data
+    auto it = slabs.upper_bound(static_cast<const char*>(data));
+    return std::prev(it)->second.get();
+}
+
+void SlabArena::remove_partial(ArenaSlab* slab) {
+    auto it = partial.find(slab->block_size);
+    it->second.erase(std::find(it->second.begin(), it->second.end(), slab));
+    if (it->second.empty()) {
+        // Dedicated slabs come in arbitrary sizes; do not keep a list for each
+        partial.erase(it);
+    }
+    slab->in_partial = false;
+}
+
+void SlabArena::drop_slab(ArenaSlab* slab) {
+    if (slab->in_partial) {
+        remove_partial(slab);
+    }
+    if (!slab->deferred_blocks.empty()) {
+        waiting.erase(std::find(waiting.begin(), waiting.end(), slab));
+        forget_deferred(slab);
+    }
+    reserved_bytes -= slab->block_size * slab->block_count;
+
+    // Outstanding handles keep the memory itself alive until they go
+    slabs.erase(slab->memory.get());
+}
+
+bool SlabArena::pinned(const ArenaSlab* slab) const {
+    // The arena holds one reference and each shared block one more;
+    // anything beyond that is a handle that might point at a freed block
+    bool pinned = slabs.at(slab->memory.get()).use_count() > static_cast<long>(slab->shared + 1);
+    if (!pinned) {
+        // Order the last handle's reads before the block is written again
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return pinned;
+}
+
+void SlabArena::free_block(ArenaSlab* slab, uint32_t block) {
+    slab->free_blocks.push_back(block);
+    if (!slab->in_partial) {
+        partial[slab->block_size].push_back(slab);
+        slab->in_partial = true;
+    }
+}
+
+void SlabArena::forget_deferred(ArenaSlab* slab) {
+    deferred_bytes -= slab->deferred_blocks.size() * slab->block_size;
+    slab->deferred_blocks.clear();
+}
+
+size_t SlabArena::reclaim_deferred() {
+    for (size_t i = 0; i < waiting.size();) {
+        ArenaSlab* slab = waiting[i];
+        if (!pinned(slab)) {
+            for (uint32_t block : slab->deferred_blocks) {
+                free_block(slab, block);
+            }
+            forget_deferred(slab);
+            waiting[i] = waiting.back();
+            waiting.pop_back();
+        } else {
+            ++i;
+        }
+    }
+    return deferred_bytes;
+}
+
+void* SlabArena::allocate(size_t bytes) {
+    size_t size = block_size_for(bytes);
+    auto it = partial.find(size);
+    if (it == partial.end() && !waiting.empty()) {
+        // A deferred block of this class may be free by now; only worth
+        // checking before adding a slab
+        reclaim_deferred();
+        it = partial.find(size);
+    }
+    ArenaSlab* slab = it == partial.end() ? add_slab(size) : it->second.back();
+
+    uint32_t block;
+    if (!slab->free_blocks.empty()) {
+        block = slab->free_blocks.back();
+        slab->free_blocks.pop_back();
+    } else {
+        block = static_cast<uint32_t>(slab->carved++);
+    }
+    if (slab->free_blocks.empty() && slab->carved == slab->block_count) {
+        remove_partial(slab);
+    }
+
+    slab->live++;
+    block_bytes += size;
+    requested_bytes += bytes;
+    return slab->memory.get() + block * size;
+}
+
+void SlabArena::release(void* data, size_t bytes, bool shared) {
+    ArenaSlab* slab = slab_of(data);
+    uint32_t block = static_cast<uint32_t>((static_cast<char*>(data) - slab->memory.get()) / slab->block_size);
+    slab->live--;
+    if (shared) {
+        slab->shared--;
+    }
+    block_bytes -= slab->block_size;
+    requested_bytes -= bytes;
+
+    if (slab->live == 0) {
+        drop_slab(slab);
+    } else if (pinned(slab)) {
+        if (slab->deferred_blocks.empty()) {
+            waiting.push_back(slab);
+        }
+        slab->deferred_blocks.push_back(block);
+        deferred_bytes += slab->block_size;
+    } else {
+        free_block(slab, block);
+    }
+}
+
+std::shared_ptr<const void> SlabArena::share(const void* data) {
+    ArenaSlab* slab = slab_of(data);
+    slab->shared++;
+    return slabs.at(slab->memory.get());
+}
+
+ArenaStats SlabArena::stats() const {
+    size_t deferred_blocks = 0;
+    for (const ArenaSlab* slab : waiting) {
+        deferred_blocks += slab->deferred_blocks.size();
+    }
+    return {reserved_bytes, block_bytes, requested_bytes, slabs.size(), deferred_blocks, deferred_bytes};
+}
@@ -0,0 +1,133 @@
+#ifndef SLAB_ARENA_H
+#define SLAB_ARENA_H
+
+#include "common.h"
+#include <map>
+#include <memory>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+// One run of equally sized blocks
+struct ArenaSlab {
+    std::unique_ptr<char[]> memory;
+    size_t block_size;
+    size_t block_count;
+    size_t carved;                     // Blocks [carved, block_count) were never handed out
+    size_t live;                       // Blocks currently allocated
+    size_t shared;                     // Live blocks holding a reference from share()
+    std::vector<uint32_t> free_blocks;
+    std::vector<uint32_t> deferred_blocks;  // Freed while a handle pinned the slab
+    bool in_partial;                   // Listed as having a free block
+};
+
+struct ArenaStats {
+    size_t reserved_bytes;   // Slab memory held
+    size_t block_bytes;      // Bytes of allocated blocks
+    size_t requested_bytes;  // Bytes callers asked for
+    size_t slabs;
+    size_t deferred_blocks;  // Freed but still visible through an outstanding handle
+    size_t deferred_bytes;
+};
+
+/**
+ * Size-class slab allocator for cache entries
+ * Blocks are carved from slabs (CACHE_SLAB_SIZE at most, smaller for small
+ * budgets), one size class per slab, so inserts rarely reach malloc and
+ * memory use follows the slab count. Slabs are reference-counted: a handle
+ * aliasing a slab keeps its memory alive, and a freed block is not reused
+ * while any handle still pins its slab. Such deferred blocks wait on their
+ * slab, and are checked again only when the arena would otherwise grow or
+ * the owner asks (reclaim_deferred()), one check per pinned slab. Empty
+ * slabs are returned immediately. Not thread-safe; the owner locks.
+ */
+class SlabArena {
+private:
+    std::map<const char*, std::shared_ptr<ArenaSlab>> slabs;        // By memory address
+    std::unordered_map<size_t, std::vector<ArenaSlab*>> partial;  // By block size
+    std::vector<ArenaSlab*> waiting;  // Slabs with deferred blocks
+    size_t slab_size;
+    size_t reserved_bytes;
+    size_t deferred_bytes;
+    size_t block_bytes;
+    size_t requested_bytes;
+
+    // Private helper methods
+    ArenaSlab* add_slab(size_t block_size);
+    ArenaSlab* slab_of(const void* data) const;
+    void drop_slab(ArenaSlab* slab);
+    void remove_partial(ArenaSlab* slab);
+    bool pinned(const ArenaSlab* slab) const;
+    void free_block(ArenaSlab* slab, uint32_t block);
+    void forget_deferred(ArenaSlab* slab);
+
+public:
+    explicit SlabArena(size_t slab_bytes = CACHE_SLAB_SIZE);
+
+    // Delete copy constructor and assignment operator
+    SlabArena(const SlabArena&) = delete;
+    SlabArena& operator=(const SlabArena&) = delete;
+
+    // Size of the block a request of this many bytes is rounded up to
+    static size_t block_size_for(size_t bytes, size_t slab_bytes);
+    size_t block_size_for(size_t bytes) const { return block_size_for(bytes, slab_size); }
+
+    // Blocks are 16-byte aligned
+    void* allocate(size_t bytes);
+
+    // shared says whether the block's reference from share() is still held;
+    // any other reference the caller took must be gone
+    void release(void* data, size_t bytes, bool shared = false);
+
+    // Shared ownership of the block's slab, for aliasing handles. The arena
+    // counts it as the block's own until release(data, bytes, true).
+    std::shared_ptr<const void> share(const void* data);
+
+    // Make deferred blocks whose slab is no longer pinned reusable; returns
+    // the bytes still deferred
+    size_t reclaim_deferred();
+
+    ArenaStats stats() const;
+};
+
+// Standard allocator over a SlabArena, or the heap when it has none
+template <typename T>
+class ArenaAllocator {
+private:
+    SlabArena* arena;
+
+    template <typename U>
+    friend class ArenaAllocator;
+
+public:
+    using value_type = T;
+
+    ArenaAllocator(SlabArena* slab_arena = nullptr) noexcept : arena(slab_arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        static_assert(alignof(T) <= 16, "Arena blocks are 16-byte aligned");
+        if (!arena) {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T*>(arena->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* data, size_t n) noexcept {
+        if (!arena) {
+            ::operator delete(data);
+            return;
+        }
+        arena->release(data, n * sizeof(T));
+    }
+
+    SlabArena* get_arena() const { return arena; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include "common.h"
+#include "event_count.h"
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Move-only void() callable for the thread pool
+ * Unlike std::function it never copies the callable and keeps anything up
+ * to THREAD_POOL_TASK_INLINE_SIZE bytes in place, so queueing a lambda
+ * does not touch the heap; larger callables are boxed. Moving a task
+ * relocates the callable with its own move constructor.
+ */
+class Task {
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*relocate)(void* to, void* from) noexcept;  // Move-construct into to, destroy from
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    template <typename D>
+    static constexpr bool fits_inline = sizeof(D) <= THREAD_POOL_TASK_INLINE_SIZE &&
+                                        alignof(D) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible<D>::value;
+
+    template <typename D>
+    static D* inline_target(void* storage) {
+        return std::launder(reinterpret_cast<D*>(storage));
+    }
+
+    template <typename D>
+    static D*& boxed_target(void* storage) {
+        return *std::launder(reinterpret_cast<D**>(storage));
+    }
+
+    template <typename D>
+    static constexpr Ops inline_ops = {
+        [](void* storage) { (*inline_target<D>(storage))(); },
+        [](void* to, void* from) noexcept {
+            new (to) D(std::move(*inline_target<D>(from)));
+            inline_target<D>(from)->~D();
+        },
+        [](void* storage) noexcept { inline_target<D>(storage)->~D(); },
+    };
+
+    template <typename D>
+    static constexpr Ops boxed_ops = {
+        [](void* storage) { (*boxed_target<D>(storage))(); },
+        [](void* to, void* from) noexcept { new (to) D*(boxed_target<D>(from)); },
+        [](void* storage) noexcept { delete boxed_target<D>(storage); },
+    };
+
+    alignas(std::max_align_t) unsigned char storage[THREAD_POOL_TASK_INLINE_SIZE];
+    const Ops* ops;  // nullptr when empty
+
+    template <typename F>
+    using EnableIfCallable = std::enable_if_t<!std::is_same<std::decay_t<F>, Task>::value &&
+                                              !std::is_same<std::decay_t<F>, std::nullptr_t>::value>;
+
+    void reset() noexcept {
+        if (ops) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+
+public:
+    Task() noexcept : ops(nullptr) {}
+    Task(std::nullptr_t) noexcept : ops(nullptr) {}
+
+    // Only throws if the callable's own constructor does, or it has to be boxed
+    template <typename F, typename = EnableIfCallable<F>>
+    Task(F&& f) noexcept(fits_inline<std::decay_t<F>> && std::is_nothrow_constructible<std::decay_t<F>, F&&>::value) {
+        using D = std::decay_t<F>;
+        if constexpr (fits_inline<D>) {
+            new (storage) D(std::forward<F>(f));
+            ops = &inline_ops<D>;
+        } else {
+            new (storage) D*(new D(std::forward<F>(f)));
+            ops = &boxed_ops<D>;
+        }
+    }
+
+    Task(Task&& other) noexcept : ops(other.ops) {
+        if (ops) {
+            ops->relocate(storage, other.storage);
+            other.ops = nullptr;
+        }
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            reset();
+            if (other.ops) {
+                other.ops->relocate(storage, other.storage);
+                ops = other.ops;
+                other.ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    Task& operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    ~Task() { reset(); }
+
+    // Delete copy constructor and assignment operator
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    void operator()() { ops->invoke(storage); }
+    explicit operator bool() const { return ops != nullptr; }
+
+    // True for a null function pointer, an empty std::function or Task, and
+    // anything else that tests false; lambdas are never null
+    template <typename F>
+    static bool is_null(const F& f) {
+        if constexpr (std::is_constructible<bool, const F&>::value) {
+            return !static_cast<bool>(f);
+        } else {
+            return false;
+        }
+    }
+};
+
+// Result slot shared by a submitted task and its TaskFuture
+template <typename R>
+struct TaskState {
+    std::atomic<bool> done;
+    EventCount finished;
+    std::exception_ptr error;
+    std::optional<std::conditional_t<std::is_void<R>::value, bool, R>> value;
+
+    TaskState() : done(false) {}
+
+    template <typename F>
+    void run(F& fn) noexcept {
+        try {
+            if constexpr (std::is_void<R>::value) {
+                fn();
+            } else {
+                value.emplace(fn());
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        done.store(true, std::memory_order_release);
+        finished.notify_all();
+    }
+
+    void wait() {
+        while (!done.load(std::memory_order_acquire)) {
+            uint32_t key = finished.prepare_wait();
+            if (done.load(std::memory_order_acquire)) {
+                finished.cancel_wait(key);
+                return;
+            }
+            finished.wait(key);
+        }
+    }
+};
+
+/**
+ * Result of ThreadPool::submit
+ * One shared allocation and no mutex: a waiter sleeps on a futex until the
+ * task has run. As with std::future, a worker waiting on a task queued
+ * behind it can deadlock a pool that has no other worker free.
+ */
+template <typename R>
+class TaskFuture {
+private:
+    std::shared_ptr<TaskState<R>> state;
+
+public:
+    TaskFuture() = default;
+    explicit TaskFuture(std::shared_ptr<TaskState<R>> task_state) : state(std::move(task_state)) {}
+
+    bool valid() const { return state != nullptr; }
+    bool ready() const { return state->done.load(std::memory_order_acquire); }
+    void wait() const { state->wait(); }
+
+    // Wait, then return the result or rethrow what the task threw; call once
+    R get() {
+        state->wait();
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+        if constexpr (!std::is_void<R>::value) {
+            return std::move(*state->value);
+        }
+    }
+};
+
+#endif
@@ -1,58 +1,281 @@
 #include "thread_pool.h"
+#include <algorithm>
 #include <iostream>
 
-ThreadPool::ThreadPool(int size) : pool_size(size), stop(false), active_count(0) {
+namespace {
+    
+// The pool and deque of the worker running on this thread, if any
+struct WorkerContext {
+    const ThreadPool* pool = nullptr;
+    WorkDeque<Task>* deque = nullptr;
+    std::vector<Task*> spare;  // Emptied task nodes, so pushes need not allocate
+};
+    
+thread_local WorkerContext current_worker;
+    
+Task* acquire_node(Task&& task) {
+    if (current_worker.spare.empty()) {
+        return new Task(std::move(task));
+    }
+    Task* node = current_worker.spare.back();
+    current_worker.spare.pop_back();
+    *node = std::move(task);
+    return node;
+}
+    
+// Thieves recycle nodes they did not allocate; the cap keeps one-way
+// traffic from hoarding them
+void recycle_node(Task* node) {
+    *node = nullptr;
+    if (current_worker.spare.size() < THREAD_POOL_SPARE_TASKS) {
+        current_worker.spare.push_back(node);
+    } else {
+        delete node;
+    }
+}
+    
+// xorshift64: cheap victim choice, one state per worker
+uint64_t next_random(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+    
+// Tell the core this is a spin-wait: frees pipeline resources for a sibling hyperthread
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+    
+}  // namespace
+
+ThreadPool::ThreadPool(int size, ThreadPoolMode pool_mode, int max_workers, int idle_timeout, int grow_wait)
+    : min_size(size), max_size(std::max(size, max_workers)), mode(pool_mode), closed(false), producers(0),
+      stop(false), active_count(0), live_workers(0),
+      spin_rounds(std::thread::hardware_concurrency() > 1 ? THREAD_POOL_SPIN_ROUNDS : 0),
+      idle_timeout_ms(idle_timeout), grow_wait_ms(grow_wait), started(0), grown(0), retired(0),
+      monitor_running(false) {
     if (size <= 0) {
         throw std::invalid_argument("Thread pool size must be positive");
     }
+    if (max_workers != 0 && max_workers < size) {
+        throw std::invalid_argument("Thread pool maximum must not be below its size");
+    }
+    if (idle_timeout <= 0 || grow_wait <= 0) {
+        throw std::invalid_argument("Thread pool idle timeout and grow wait must be positive");
+    }
     
     try {
-        workers.reserve(pool_size);
-        for (int i = 0; i < pool_size; ++i) {
-            workers.emplace_back(&ThreadPool::worker_thread, this);
+        workers.resize(max_size);
+        slot_used.assign(max_size, false);
+        if (mode == ThreadPoolMode::WORK_STEALING) {
+            // Every deque exists before any worker can pick a victim
+            for (int i = 0; i < max_size; ++i) {
+                deques.push_back(std::make_unique<WorkDeque<Task>>());
+            }
         }
-        std::cout << "[ThreadPool] Created with " << pool_size << " worker threads" << std::endl;
-    } catch (const std::exception& e) {
-        // If thread creation fails, clean up and rethrow
-        stop = true;
-        condition.notify_all();
-        for (auto& worker : workers) {
-            if (worker.joinable()) {
-                worker.join();
+        {
+            std::lock_guard<std::mutex> lock(workers_mutex);
+            for (int i = 0; i < min_size; ++i) {
+                start_worker(static_cast<size_t>(i));
             }
         }
+        if (is_elastic()) {
+            monitor_running = true;
+            monitor = std::thread(&ThreadPool::monitor_loop, this);
+        }
+        std::cout << "[ThreadPool] Created with " << min_size << " worker threads"
+                  << (is_elastic() ? " (elastic up to " + std::to_string(max_size) + ")" : "")
+                  << (mode == ThreadPoolMode::WORK_STEALING ? " (work stealing)" : "") << std::endl;
+    } catch (const std::exception& e) {
+        // If thread creation fails, clean up and rethrow
+        shutdown();
         throw;
     }
 }
 
 ThreadPool::~ThreadPool() {
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        stop = true;
+    shutdown();
+    std::cout << "[ThreadPool] All workers terminated" << std::endl;
+}
+
+void ThreadPool::shutdown() {
+    // The monitor first, so no worker starts while the rest are joined
+    if (monitor.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(monitor_mutex);
+            monitor_running = false;
+        }
+        monitor_wake.notify_one();
+        monitor.join();
     }
-    condition.notify_all();
     
+    // Close to new tasks, then let enqueues already past the check publish
+    // theirs; only then may workers treat empty queues as the end
+    closed.store(true, std::memory_order_seq_cst);
+    while (producers.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+    }
+    stop = true;
+    idle.notify_all();
+    
+    // Includes retired workers that have not been joined yet
     for (std::thread& worker : workers) {
         if (worker.joinable()) {
             worker.join();
         }
     }
-    std::cout << "[ThreadPool] All workers terminated" << std::endl;
 }
 
-void ThreadPool::enqueue(std::function<void()> task) {
-    if (!task) {
-        throw std::invalid_argument("Cannot enqueue null task");
+void ThreadPool::start_worker(size_t index) {
+    // Caller holds workers_mutex. A retired worker left the slot free as its
+    // last locked step, so joining it here cannot wait on the lock
+    if (workers[index].joinable()) {
+        workers[index].join();
     }
-    
-    {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        if (stop) {
-            throw std::runtime_error("Cannot enqueue task on stopped thread pool");
+    slot_used[index] = true;
+    live_workers++;
+    try {
+        if (mode == ThreadPoolMode::WORK_STEALING) {
+            workers[index] = std::thread(&ThreadPool::stealing_worker, this, index);
+        } else {
+            workers[index] = std::thread(&ThreadPool::worker_thread, this, index);
+        }
+    } catch (...) {
+        slot_used[index] = false;
+        live_workers--;
+        throw;
+    }
+}
+
+void ThreadPool::retire_worker(size_t index) {
+    // live_workers already counts this worker out
+    retired.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(workers_mutex);
+    std::cout << "[ThreadPool] Retired an idle worker, " << live_workers.load() << " left" << std::endl;
+    slot_used[index] = false;
+}
+
+void ThreadPool::grow(int64_t backlog_ms) {
+    std::lock_guard<std::mutex> lock(workers_mutex);
+    if (live_workers.load() >= max_size) {
+        return;
+    }
+    // A retiring worker has given up its place in live_workers just before its slot
+    auto slot = std::find(slot_used.begin(), slot_used.end(), false);
+    if (slot == slot_used.end()) {
+        return;
+    }
+    // Counted first: the new worker may finish a task before this returns
+    grown.fetch_add(1, std::memory_order_relaxed);
+    try {
+        start_worker(static_cast<size_t>(slot - slot_used.begin()));
+    } catch (const std::exception& e) {
+        grown.fetch_sub(1, std::memory_order_relaxed);
+        std::cerr << "[ThreadPool] Failed to add a worker: " << e.what() << std::endl;
+        return;
+    }
+    std::cout << "[ThreadPool] Queue wait ~" << backlog_ms << " ms, grew to " << live_workers.load()
+              << " workers" << std::endl;
+}
+
+void ThreadPool::monitor_loop() {
+    std::unique_lock<std::mutex> lock(monitor_mutex);
+    uint64_t last_started = started.load(std::memory_order_relaxed);
+    int64_t backlog_ms = 0;
+    while (!monitor_wake.wait_for(lock, std::chrono::milliseconds(THREAD_POOL_MONITOR_INTERVAL_MS),
+                                  [this]() { return !monitor_running; })) {
+        uint64_t now_started = started.load(std::memory_order_relaxed);
+        uint64_t progress = now_started - last_started;
+        last_started = now_started;
+        
+        // Only a backlog no worker is free to take calls for another worker
+        size_t queued = get_queue_size();
+        if (queued == 0 || active_count.load() < live_workers.load()) {
+            backlog_ms = 0;
+            continue;
         }
-        tasks.push(std::move(task));
+        // Little's law: the newest task waits about backlog / take rate; with
+        // nothing taken (every worker blocked) the backlog just ages
+        backlog_ms = progress > 0 ? static_cast<int64_t>(queued * THREAD_POOL_MONITOR_INTERVAL_MS / progress)
+                                  : backlog_ms + THREAD_POOL_MONITOR_INTERVAL_MS;
+        if (backlog_ms >= grow_wait_ms) {
+            lock.unlock();
+            grow(backlog_ms);
+            lock.lock();
+            // Give the new worker a full period before judging again
+            backlog_ms = 0;
+        }
+    }
+}
+
+bool ThreadPool::on_worker() const {
+    return current_worker.pool == this;
+}
+
+void ThreadPool::enqueue_task(Task&& task, TaskPriority priority) {
+    push_task(std::move(task), priority);
+    // Wakes a parked worker, if any, to run or steal it
+    idle.notify_one();
+}
+
+void ThreadPool::submit_bulk(Task* batch, size_t count, TaskPriority priority) {
+    for (size_t i = 0; i < count; ++i) {
+        if (!batch[i]) {
+            throw std::invalid_argument("Cannot enqueue null task");
+        }
+    }
+    ProducerScope scope(closed, producers);
+    if (count == 0) {
+        return;
+    }
+    
+    for (size_t i = 0; i < count; ++i) {
+        push_task(std::move(batch[i]), priority);
+    }
+    idle.notify(static_cast<uint32_t>(std::min<size_t>(count, UINT32_MAX)));
+}
+
+void ThreadPool::push_task(Task&& task, TaskPriority priority) {
+    if (priority == TaskPriority::NORMAL && on_worker()) {
+        // From one of our own workers: its deque, no lock
+        current_worker.deque->push(acquire_node(std::move(task)));
+    } else {
+        push_shared(lane_for(priority), std::move(task));
+    }
+}
+
+void ThreadPool::push_shared(Lane& lane, Task&& task) {
+    // Once anything has overflowed, later tasks queue behind it until it drains
+    if (lane.overflow_count.load(std::memory_order_relaxed) == 0 && lane.tasks.try_emplace(std::move(task))) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(lane.overflow_mutex);
+    lane.overflow.push(std::move(task));
+    lane.overflow_count.fetch_add(1, std::memory_order_release);
+}
+
+bool ThreadPool::pop_shared(Lane& lane, Task& task) {
+    if (lane.tasks.try_pop(task)) {
+        return true;
     }
-    condition.notify_one();
+    if (lane.overflow_count.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(lane.overflow_mutex);
+    if (lane.overflow.empty()) {
+        return false;
+    }
+    task = std::move(lane.overflow.front());
+    lane.overflow.pop();
+    lane.overflow_count.fetch_sub(1, std::memory_order_relaxed);
+    return true;
 }
 
 int ThreadPool::get_active_count() const {
@@ -60,42 +283,184 @@ int ThreadPool::get_active_count() const {
 }
 
 int ThreadPool::get_pool_size() const {
-    return pool_size;
+    return live_workers.load();
 }
 
 size_t ThreadPool::get_queue_size() const {
-    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(queue_mutex));
-    return tasks.size();
+    size_t total = 0;
+    for (const Lane& lane : lanes) {
+        total += lane.tasks.size() + lane.overflow_count.load(std::memory_order_relaxed);
+    }
+    for (const auto& deque : deques) {
+        total += deque->size();
+    }
+    return total;
 }
 
-void ThreadPool::worker_thread() {
+void ThreadPool::run_task(Task& task) {
+    active_count++;
+    if (is_elastic()) {
+        started.fetch_add(1, std::memory_order_relaxed);
+    }
+    try {
+        task();
+    } catch (const std::exception& e) {
+        std::cerr << "[ThreadPool] Exception in worker thread: " << e.what() << std::endl;
+    } catch (...) {
+        std::cerr << "[ThreadPool] Unknown exception in worker thread" << std::endl;
+    }
+    active_count--;
+}
+
+void ThreadPool::worker_thread(size_t index) {
+    Task task;
     while (true) {
-        std::function<void()> task;
-        
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            condition.wait(lock, [this] { return stop || !tasks.empty(); });
-            
-            if (stop && tasks.empty()) {
-                return;
+        if (pop_shared(lane_for(TaskPriority::HIGH), task) || pop_shared(lane_for(TaskPriority::NORMAL), task)) {
+            run_task(task);
+            task = nullptr;
+            continue;
+        }
+        if (stop && !has_work()) {
+            return;
+        }
+        if (!wait_for_work()) {
+            retire_worker(index);
+            return;
+        }
+    }
+}
+
+bool ThreadPool::has_work() const {
+    for (const Lane& lane : lanes) {
+        if (!lane.tasks.empty() || lane.overflow_count.load(std::memory_order_relaxed) > 0) {
+            return true;
+        }
+    }
+    for (const auto& deque : deques) {
+        if (!deque->empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::wait_for_work() {
+    // A task usually follows soon under load; polling beats a futex round
+    // trip, unless the poller is keeping the producer off the only core
+    for (int round = 0; round < spin_rounds; ++round) {
+        if (has_work() || stop) {
+            return true;
+        }
+        cpu_relax();
+    }
+    
+    // Park unless something arrived meanwhile; every push notifies after
+    // publishing, so a task that this re-check misses wakes us
+    uint32_t key = idle.prepare_wait();
+    if (has_work() || stop) {
+        idle.cancel_wait(key);
+        return true;
+    }
+    if (!is_elastic()) {
+        idle.wait(key);
+        return true;
+    }
+    if (idle.wait_for(key, std::chrono::milliseconds(idle_timeout_ms)) || !idle.cancel_wait(key)) {
+        // Woken, or picked by a notify just as the wait timed out
+        return true;
+    }
+    
+    // Idle for the whole timeout: leave if the pool can spare us
+    int live = live_workers.load();
+    while (live > min_size) {
+        if (live_workers.compare_exchange_weak(live, live - 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Task* ThreadPool::steal(size_t thief, uint64_t& rng) {
+    // A few random victims, then everyone in turn so no task is overlooked
+    size_t count = deques.size();
+    for (size_t attempt = 0; attempt < count; ++attempt) {
+        size_t victim = next_random(rng) % count;
+        if (victim != thief) {
+            if (Task* task = deques[victim]->steal()) {
+                return task;
             }
-            
-            if (!tasks.empty()) {
-                task = std::move(tasks.front());
-                tasks.pop();
+        }
+    }
+    for (size_t victim = 0; victim < count; ++victim) {
+        if (victim != thief) {
+            if (Task* task = deques[victim]->steal()) {
+                return task;
             }
         }
+    }
+    return nullptr;
+}
+
+void ThreadPool::stealing_worker(size_t index) {
+    WorkDeque<Task>& local = *deques[index];
+    current_worker.pool = this;
+    current_worker.deque = &local;
+    uint64_t rng = 0x9E3779B97F4A7C15ULL * (index + 1);
+    
+    Task injected;
+    while (true) {
+        // Urgent work from anywhere goes ahead of everything
+        if (pop_shared(lane_for(TaskPriority::HIGH), injected)) {
+            run_task(injected);
+            injected = nullptr;
+            continue;
+        }
+        
+        // Then own work, newest first while it is still in cache
+        if (Task* task = local.take()) {
+            run_task(*task);
+            recycle_node(task);
+            continue;
+        }
         
-        if (task) {
-            active_count++;
-            try {
-                task();
-            } catch (const std::exception& e) {
-                std::cerr << "[ThreadPool] Exception in worker thread: " << e.what() << std::endl;
-            } catch (...) {
-                std::cerr << "[ThreadPool] Unknown exception in worker thread" << std::endl;
+        // Then submissions from outside the pool
+        if (pop_shared(lane_for(TaskPriority::NORMAL), injected)) {
+            run_task(injected);
+            injected = nullptr;
+            continue;
+        }
+        
+        // Then other workers' oldest tasks
+        if (Task* task = steal(index, rng)) {
+            run_task(*task);
+            recycle_node(task);
+            continue;
+        }
+        
+        // A failed steal may only have lost a race; leave once nothing is left
+        bool leaving = stop && !has_work();
+        bool retiring = !leaving && !wait_for_work();
+        if (leaving || retiring) {
+            for (Task* node : current_worker.spare) {
+                delete node;
+            }
+            current_worker.spare.clear();
+            current_worker.pool = nullptr;
+            if (retiring) {
+                retire_worker(index);
             }
-            active_count--;
+            return;
         }
     }
 }
+
+bool parse_thread_pool_mode(const std::string& name, ThreadPoolMode& mode) {
+    if (name == "shared") {
+        mode = ThreadPoolMode::SHARED_QUEUE;
+    } else if (name == "stealing") {
+        mode = ThreadPoolMode::WORK_STEALING;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -1,52 +1,219 @@
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 
+#include "common.h"
+#include "event_count.h"
+#include "mpmc_queue.h"
+#include "task.h"
+#include "work_deque.h"
 #include <vector>
 #include <queue>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
-#include <functional>
 #include <atomic>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
+
+enum class ThreadPoolMode : uint8_t {
+    SHARED_QUEUE,  // Every task goes through one queue and lock
+    WORK_STEALING  // Per-worker deques; the shared queue only takes outside submissions
+};
+
+// Queued tasks of a higher priority always run first; within one, FIFO
+enum class TaskPriority : uint8_t {
+    HIGH,   // Latency-sensitive: delivering broadcasts
+    NORMAL  // Everything else, including maintenance and statistics
+};
+
+constexpr size_t TASK_PRIORITY_LEVELS = 2;
 
 /**
  * Thread pool implementation for handling concurrent client connections
  * Uses a fixed number of worker threads to process tasks from a queue
+ *
+ * Each priority has its own queue: a lock-free bounded ring; tasks only go
+ * to a locked overflow list while a burst has it full. An idle worker polls
+ * for a few rounds, then parks on an event count, so enqueueing costs no
+ * syscall while the workers are busy or spinning. submit_bulk() queues a
+ * whole batch and then wakes as many workers as it needs in one go.
+ *
+ * In work-stealing mode each worker owns a Chase-Lev deque. Tasks enqueued
+ * by a worker go onto its own deque, lock-free, and it runs them newest
+ * first; the shared queue becomes an injection queue for tasks from other
+ * threads. A worker with nothing local takes from the injection queue,
+ * then steals the oldest task of a randomly chosen worker, and parks only
+ * when every queue is empty. High-priority tasks always go to the shared
+ * queue, which every worker checks before its own deque.
+ *
+ * An elastic pool (max_size above size) keeps at least size workers. A
+ * monitor thread estimates how long queued tasks wait, from the backlog and
+ * the rate workers take tasks; past grow_wait_ms, with every worker busy,
+ * it adds one, up to max_size. A worker above the minimum that stays idle
+ * for idle_timeout_ms retires. Both default to THREAD_POOL_GROW_WAIT_MS and
+ * THREAD_POOL_IDLE_TIMEOUT_MS.
  */
 class ThreadPool {
 private:
-    std::vector<std::thread> workers;
-    std::queue<std::function<void()>> tasks;
+    // The shared queue of one priority
+    struct Lane {
+        MpmcQueue<Task> tasks;
+        std::queue<Task> overflow;  // Tasks that found the ring full, until it has drained
+        std::mutex overflow_mutex;
+        std::atomic<size_t> overflow_count;
+        
+        Lane() : tasks(THREAD_POOL_QUEUE_CAPACITY), overflow_count(0) {}
+    };
     
-    std::mutex queue_mutex;
-    std::condition_variable condition;
-    std::atomic<bool> stop;
+    std::vector<std::thread> workers;  // One slot per possible worker, max_size in all
+    Lane lanes[TASK_PRIORITY_LEVELS];
+    
+    int min_size;
+    int max_size;
+    ThreadPoolMode mode;
+    std::vector<std::unique_ptr<WorkDeque<Task>>> deques;  // Work-stealing mode, one per worker slot
+    
+    EventCount idle;  // Where workers with nothing to run park
+    std::atomic<bool> closed;     // No new tasks; set before stop
+    std::atomic<int> producers;   // Enqueues past the closed check and not yet published
+    std::atomic<bool> stop;       // Workers leave once the queues are empty
     std::atomic<int> active_count;
+    std::atomic<int> live_workers;
+    int spin_rounds;  // Polls before parking; none on a single CPU
     
-    int pool_size;
+    // Elastic mode
+    int idle_timeout_ms;            // Idle time after which a worker above min_size retires
+    int grow_wait_ms;               // Estimated queue wait at which the monitor adds a worker
+    std::mutex workers_mutex;       // Guards slot_used and starting workers
+    std::vector<bool> slot_used;    // Slots whose worker has not retired
+    std::atomic<uint64_t> started;  // Tasks taken so far, for the backlog estimate
+    std::atomic<uint64_t> grown;
+    std::atomic<uint64_t> retired;
+    std::thread monitor;
+    std::mutex monitor_mutex;
+    std::condition_variable monitor_wake;
+    bool monitor_running;
+    
+    // Holds a producer in the count while it publishes, so shutdown() can
+    // wait for it; throws if the pool has closed
+    class ProducerScope {
+    private:
+        std::atomic<int>& producers;
+    
+    public:
+        ProducerScope(const std::atomic<bool>& closed, std::atomic<int>& count) : producers(count) {
+            // Pairs with shutdown(): either this sees closed, or shutdown() sees the count
+            producers.fetch_add(1, std::memory_order_seq_cst);
+            if (closed.load(std::memory_order_seq_cst)) {
+                producers.fetch_sub(1, std::memory_order_release);
+                throw std::runtime_error("Cannot enqueue task on stopped thread pool");
+            }
+        }
+        ~ProducerScope() { producers.fetch_sub(1, std::memory_order_release); }
+        
+        ProducerScope(const ProducerScope&) = delete;
+        ProducerScope& operator=(const ProducerScope&) = delete;
+    };
+    
+    // Private helper methods
+    void worker_thread(size_t index);
+    void stealing_worker(size_t index);
+    void start_worker(size_t index);
+    void retire_worker(size_t index);
+    void monitor_loop();
+    void grow(int64_t backlog_ms);
+    void run_task(Task& task);
+    bool on_worker() const;
+    Lane& lane_for(TaskPriority priority) { return lanes[static_cast<size_t>(priority)]; }
+    void enqueue_task(Task&& task, TaskPriority priority);
+    void push_task(Task&& task, TaskPriority priority);
+    void push_shared(Lane& lane, Task&& task);
+    bool pop_shared(Lane& lane, Task& task);
+    Task* steal(size_t thief, uint64_t& rng);
+    bool has_work() const;
+    bool wait_for_work();
     
-    void worker_thread();
-
 public:
-    explicit ThreadPool(int size);
+    // size workers; with max_workers above size the pool is elastic
+    explicit ThreadPool(int size, ThreadPoolMode pool_mode = ThreadPoolMode::SHARED_QUEUE, int max_workers = 0,
+                        int idle_timeout = THREAD_POOL_IDLE_TIMEOUT_MS, int grow_wait = THREAD_POOL_GROW_WAIT_MS);
     ~ThreadPool();
     
     // Delete copy constructor and assignment operator
     ThreadPool(const ThreadPool&) = delete;
     ThreadPool& operator=(const ThreadPool&) = delete;
     
-    // Enqueue a task to be executed by the thread pool
-    void enqueue(std::function<void()> task);
+    // Enqueue a task to be executed by the thread pool; a callable that
+    // moves without throwing is built straight into its queue slot
+    template <typename F>
+    void enqueue(F&& f, TaskPriority priority = TaskPriority::NORMAL);
+    
+    // Enqueue a task and get a future for its result (or exception)
+    template <typename F>
+    TaskFuture<std::invoke_result_t<std::decay_t<F>&>> submit(F&& f, TaskPriority priority = TaskPriority::NORMAL);
+    
+    // Enqueue count tasks, moved from batch, with a single wakeup; if any
+    // is null or the pool has stopped, throws without enqueueing any
+    void submit_bulk(Task* batch, size_t count, TaskPriority priority = TaskPriority::NORMAL);
+    
+    // Stop taking tasks, run every task already accepted and join the
+    // workers; the destructor calls it. Enqueues racing it either throw or
+    // are run before it returns
+    void shutdown();
     
     // Get the number of currently active worker threads
     int get_active_count() const;
     
-    // Get the total size of the thread pool
+    // Get the total size of the thread pool (workers running now)
     int get_pool_size() const;
+    ThreadPoolMode get_mode() const { return mode; }
+    
+    // Elastic bounds, and how often the pool has grown and shrunk
+    bool is_elastic() const { return max_size > min_size; }
+    int get_min_size() const { return min_size; }
+    int get_max_size() const { return max_size; }
+    uint64_t get_grow_count() const { return grown.load(std::memory_order_relaxed); }
+    uint64_t get_shrink_count() const { return retired.load(std::memory_order_relaxed); }
     
-    // Get the number of pending tasks in the queue
+    // Get the number of pending tasks in the queue (and the worker deques);
+    // approximate, and lock-free
     size_t get_queue_size() const;
 };
 
+template <typename F>
+void ThreadPool::enqueue(F&& f, TaskPriority priority) {
+    if (Task::is_null(f)) {
+        throw std::invalid_argument("Cannot enqueue null task");
+    }
+    ProducerScope scope(closed, producers);
+    
+    if constexpr (std::is_nothrow_constructible<Task, F&&>::value) {
+        // The ring leaves f alone if it is full
+        Lane& lane = lane_for(priority);
+        if ((priority == TaskPriority::HIGH || !on_worker()) && lane.overflow_count.load(std::memory_order_relaxed) == 0 &&
+            lane.tasks.try_emplace(std::forward<F>(f))) {
+            idle.notify_one();
+            return;
+        }
+    }
+    enqueue_task(Task(std::forward<F>(f)), priority);
+}
+
+template <typename F>
+TaskFuture<std::invoke_result_t<std::decay_t<F>&>> ThreadPool::submit(F&& f, TaskPriority priority) {
+    using Result = std::invoke_result_t<std::decay_t<F>&>;
+    if (Task::is_null(f)) {
+        throw std::invalid_argument("Cannot enqueue null task");
+    }
+    
+    auto state = std::make_shared<TaskState<Result>>();
+    enqueue([state, fn = std::decay_t<F>(std::forward<F>(f))]() mutable { state->run(fn); }, priority);
+    return TaskFuture<Result>(std::move(state));
+}
+
+// Parse a --pool value
+bool parse_thread_pool_mode(const std::string& name, ThreadPoolMode& mode);
+
 #endif
@@ -0,0 +1,472 @@
+#include "thread_pool.h"
+#include "common.h"
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <array>
+#include <numeric>
+#include <string>
+
+void print_separator() {
+    std::cout << std::string(70, '=') << std::endl;
+}
+
+void print_test_header(const std::string& test_name) {
+    print_separator();
+    std::cout << "TEST: " << test_name << std::endl;
+    print_separator();
+}
+
+const char* mode_name(ThreadPoolMode mode) {
+    return mode == ThreadPoolMode::WORK_STEALING ? "stealing" : "shared";
+}
+
+// Occupies a worker until released
+struct Gate {
+    std::atomic<bool> entered{false};
+    std::atomic<bool> open{false};
+
+    void hold() {
+        entered = true;
+        while (!open.load()) {
+            std::this_thread::yield();
+        }
+    }
+
+    void wait_entered() const {
+        while (!entered.load()) {
+            std::this_thread::yield();
+        }
+    }
+};
+
+// Live instances, moves and calls of the Counted callables sharing it
+struct Counts {
+    int alive = 0;
+    int moves = 0;
+    int calls = 0;
+};
+
+// A callable of exactly Size bytes that reports to its Counts
+template <size_t Size>
+struct Counted {
+    Counts* counts;
+    char padding[Size - sizeof(Counts*)];
+
+    explicit Counted(Counts* c) : counts(c), padding() { counts->alive++; }
+    Counted(Counted&& other) noexcept : counts(other.counts), padding() {
+        counts->alive++;
+        counts->moves++;
+    }
+    Counted(const Counted&) = delete;
+    ~Counted() { counts->alive--; }
+
+    void operator()() { counts->calls++; }
+};
+
+// True if moving a Task holding a Size-byte callable moves the callable
+// itself (held inline) rather than a pointer to it (boxed)
+template <size_t Size>
+bool moved_inline() {
+    static_assert(sizeof(Counted<Size>) == Size, "Counted has no padding of its own");
+    Counts counts;
+    Task first{Counted<Size>(&counts)};
+    int before = counts.moves;
+    Task second(std::move(first));
+    return counts.moves == before + 1;
+}
+
+void test_task() {
+    print_test_header("Move-Only Task");
+
+    std::cout << "\n1. Move construction and assignment..." << std::endl;
+    Counts counts;
+    {
+        Task first{Counted<16>(&counts)};
+        Task second(std::move(first));
+        bool moved = !first && static_cast<bool>(second) && counts.alive == 1;
+        second();
+        std::cout << "   Source emptied, callable moved and run once: "
+                  << (moved && counts.calls == 1 ? "✓ PASS" : "✗ FAIL") << std::endl;
+
+        Counts replaced;
+        Task third{Counted<16>(&replaced)};
+        third = std::move(second);
+        third();
+        bool assigned = replaced.alive == 0 && !second && counts.alive == 1 && counts.calls == 2;
+        std::cout << "   Assignment destroys the old callable: " << (assigned ? "✓ PASS" : "✗ FAIL") << std::endl;
+
+        Counts cleared;
+        Task fourth{Counted<128>(&cleared)};
+        fourth = nullptr;
+        std::cout << "   Assigning nullptr empties and destroys: "
+                  << (!fourth && cleared.alive == 0 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    }
+    std::cout << "   Every callable destroyed exactly once: " << (counts.alive == 0 ? "✓ PASS" : "✗ FAIL")
+              << std::endl;
+
+    std::cout << "\n2. Captures of " << THREAD_POOL_TASK_INLINE_SIZE << " bytes or less are held inline..."
+              << std::endl;
+    bool at_limit = moved_inline<THREAD_POOL_TASK_INLINE_SIZE>();
+    bool small = moved_inline<16>();
+    bool over_limit = moved_inline<THREAD_POOL_TASK_INLINE_SIZE + 8>();
+    bool large = moved_inline<1024>();
+    std::cout << "   16 and " << THREAD_POOL_TASK_INLINE_SIZE << " bytes inline: "
+              << (small && at_limit ? "✓ PASS" : "✗ FAIL") << std::endl;
+    std::cout << "   " << THREAD_POOL_TASK_INLINE_SIZE + 8 << " and 1024 bytes boxed: "
+              << (!over_limit && !large ? "✓ PASS" : "✗ FAIL") << std::endl;
+
+    std::cout << "\n3. Boxed and move-only captures through the pool..." << std::endl;
+    ThreadPool pool(1);
+    std::array<int, 64> numbers;
+    std::iota(numbers.begin(), numbers.end(), 1);
+    TaskFuture<int> boxed_sum = pool.submit([numbers]() { return std::accumulate(numbers.begin(), numbers.end(), 0); });
+    std::atomic<int> boxed_enqueued(0);
+    pool.enqueue([numbers, &boxed_enqueued]() { boxed_enqueued = numbers[63]; });
+    TaskFuture<int> move_only = pool.submit([value = std::make_unique<int>(7)]() { return *value; });
+    bool through_pool = boxed_sum.get() == 64 * 65 / 2 && move_only.get() == 7;
+    while (boxed_enqueued.load() == 0) {
+        std::this_thread::yield();
+    }
+    std::cout << "   Boxed via submit and enqueue, move-only via submit: "
+              << (through_pool && boxed_enqueued.load() == 64 ? "✓ PASS" : "✗ FAIL") << std::endl;
+
+    std::cout << "\n4. Move-only capture enqueued onto a full ring..." << std::endl;
+    Gate gate;
+    pool.enqueue([&gate]() { gate.hold(); });
+    gate.wait_entered();
+    std::atomic<int> fillers(0);
+    for (size_t i = 0; i < THREAD_POOL_QUEUE_CAPACITY; ++i) {
+        pool.enqueue([&fillers]() { ++fillers; });
+    }
+    bool full = pool.get_queue_size() == THREAD_POOL_QUEUE_CAPACITY;
+    // The ring turns this away, so the same callable is boxed into a Task
+    std::atomic<int> seen(0);
+    pool.enqueue([value = std::make_unique<int>(9), &seen]() { seen = *value; });
+    gate.open = true;
+    pool.shutdown();
+    std::cout << "   Capture intact after the ring refused it: "
+              << (full && seen.load() == 9 && fillers.load() == static_cast<int>(THREAD_POOL_QUEUE_CAPACITY)
+                      ? "✓ PASS"
+                      : "✗ FAIL")
+              << std::endl;
+}
+
+void test_futures() {
+    print_test_header("Futures and Priorities");
+
+    for (ThreadPoolMode mode : {ThreadPoolMode::SHARED_QUEUE, ThreadPoolMode::WORK_STEALING}) {
+        ThreadPool pool(2, mode);
+
+        std::cout << "\n1. submit() and TaskFuture::get() (" << mode_name(mode) << ")..." << std::endl;
+        TaskFuture<int> answer = pool.submit([]() { return 42; });
+        std::cout << "   Result returned: " << (answer.get() == 42 ? "✓ PASS" : "✗ FAIL") << std::endl;
+
+        std::cout << "\n2. A task that throws (" << mode_name(mode) << ")..." << std::endl;
+        TaskFuture<int> failing = pool.submit([]() -> int { throw std::runtime_error("boom"); });
+        std::string message;
+        try {
+            failing.get();
+        } catch (const std::runtime_error& e) {
+            message = e.what();
+        }
+        std::cout << "   Exception rethrown by get(): " << (message == "boom" ? "✓ PASS" : "✗ FAIL") << std::endl;
+    }
+
+    for (ThreadPoolMode mode : {ThreadPoolMode::SHARED_QUEUE, ThreadPoolMode::WORK_STEALING}) {
+        std::cout << "\n3. NORMAL and HIGH tasks queued behind a busy worker (" << mode_name(mode) << ")..."
+                  << std::endl;
+        ThreadPool pool(1, mode);
+        Gate gate;
+        pool.enqueue([&gate]() { gate.hold(); });
+        gate.wait_entered();
+
+        std::mutex order_mutex;
+        std::string order;
+        auto record = [&order_mutex, &order](char c) {
+            return [&order_mutex, &order, c]() {
+                std::lock_guard<std::mutex> lock(order_mutex);
+                order += c;
+            };
+        };
+        for (int i = 0; i < 3; ++i) {
+            pool.enqueue(record('N'), TaskPriority::NORMAL);
+            pool.enqueue(record('H'), TaskPriority::HIGH);
+        }
+        gate.open = true;
+        pool.shutdown();
+        std::cout << "   Ran in order " << order << ": " << (order == "HHHNNN" ? "✓ PASS" : "✗ FAIL") << std::endl;
+    }
+}
+
+void test_work_stealing() {
+    print_test_header("Work Stealing");
+
+    const int children = 64;
+    std::cout << "\n1. A worker enqueues " << children << " tasks, each enqueuing one more, then blocks..."
+              << std::endl;
+    ThreadPool pool(4, ThreadPoolMode::WORK_STEALING);
+    std::atomic<int> ran(0);
+    std::atomic<bool> ran_on_owner(false);
+    std::atomic<bool> done_while_blocked(false);
+    std::thread::id owner;
+
+    TaskFuture<void> outer = pool.submit([&]() {
+        owner = std::this_thread::get_id();
+        for (int i = 0; i < children; ++i) {
+            // On the owner's own deque; only a thief can run it from here on
+            pool.enqueue([&]() {
+                if (std::this_thread::get_id() == owner) {
+                    ran_on_owner = true;
+                }
+                ++ran;
+                pool.enqueue([&ran]() { ++ran; });
+            });
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (ran.load() < 2 * children && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        done_while_blocked = ran.load() == 2 * children;
+    });
+    outer.get();
+    pool.shutdown();
+
+    std::cout << "   Every nested task ran: " << (ran.load() == 2 * children ? "✓ PASS" : "✗ FAIL") << std::endl;
+    std::cout << "   Stolen while the owner was blocked: "
+              << (done_while_blocked.load() && !ran_on_owner.load() ? "✓ PASS" : "✗ FAIL") << std::endl;
+}
+
+void test_submit_bulk() {
+    print_test_header("Bulk Submission");
+
+    for (ThreadPoolMode mode : {ThreadPoolMode::SHARED_QUEUE, ThreadPoolMode::WORK_STEALING}) {
+        std::cout << "\n1. 5000 tasks in one submit_bulk() (" << mode_name(mode) << ")..." << std::endl;
+        ThreadPool pool(4, mode);
+        std::atomic<int> ran(0);
+        std::vector<Task> batch;
+        for (int i = 0; i < 5000; ++i) {
+            batch.emplace_back([&ran]() { ++ran; });
+        }
+        pool.submit_bulk(batch.data(), batch.size());
+        pool.shutdown();
+        std::cout << "   Every task ran: " << (ran.load() == 5000 ? "✓ PASS" : "✗ FAIL") << std::endl;
+    }
+
+    std::cout << "\n2. A batch with a null task..." << std::endl;
+    ThreadPool pool(2);
+    std::atomic<int> ran(0);
+    std::vector<Task> batch;
+    for (int i = 0; i < 10; ++i) {
+        batch.emplace_back([&ran]() { ++ran; });
+    }
+    batch[7] = nullptr;
+    bool refused = false;
+    try {
+        pool.submit_bulk(batch.data(), batch.size());
+    } catch (const std::invalid_argument&) {
+        refused = true;
+    }
+    pool.shutdown();
+    bool untouched = static_cast<bool>(batch[0]) && static_cast<bool>(batch[9]);
+    std::cout << "   Refused, nothing queued: " << (refused && ran.load() == 0 && untouched ? "✓ PASS" : "✗ FAIL")
+              << std::endl;
+}
+
+// Producers submit until the pool refuses; every submit that returned must run
+bool race_submit_against_shutdown(ThreadPoolMode mode, int round) {
+    ThreadPool pool(2, mode);
+    std::atomic<int> ran(0);
+    std::atomic<bool> go(false);
+    std::vector<std::vector<TaskFuture<int>>> futures(4);
+    std::vector<std::thread> producers;
+
+    for (size_t p = 0; p < futures.size(); ++p) {
+        producers.emplace_back([&, p]() {
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+            try {
+                while (true) {
+                    futures[p].push_back(pool.submit([&ran]() { return ++ran; }));
+                }
+            } catch (const std::runtime_error&) {
+                // The pool has closed
+            }
+        });
+    }
+
+    go = true;
+    std::this_thread::sleep_for(std::chrono::microseconds(100 * (round % 10)));
+    pool.shutdown();
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+
+    size_t accepted = 0;
+    bool all_ready = true;
+    for (const auto& list : futures) {
+        accepted += list.size();
+        for (const auto& future : list) {
+            all_ready = all_ready && future.ready();
+        }
+    }
+    return all_ready && accepted == static_cast<size_t>(ran.load());
+}
+
+// Resubmits itself from a worker until the pool refuses
+struct Chain {
+    ThreadPool* pool;
+    std::atomic<int>* accepted;
+    std::atomic<int>* ran;
+
+    void operator()() const {
+        ++*ran;
+        try {
+            pool->enqueue(*this);
+            ++*accepted;
+        } catch (const std::runtime_error&) {
+            // The pool is being destroyed
+        }
+    }
+};
+
+bool race_chains_against_destruction(ThreadPoolMode mode) {
+    std::atomic<int> accepted(0);
+    std::atomic<int> ran(0);
+    auto pool = std::make_unique<ThreadPool>(3, mode);
+    for (int i = 0; i < 8; ++i) {
+        pool->enqueue(Chain{pool.get(), &accepted, &ran});
+        ++accepted;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    pool.reset();
+    return accepted.load() == ran.load();
+}
+
+void test_elastic() {
+    print_test_header("Elastic Pool");
+
+    const int idle_timeout_ms = 200;
+    const int grow_wait_ms = 20;
+    for (ThreadPoolMode mode : {ThreadPoolMode::SHARED_QUEUE, ThreadPoolMode::WORK_STEALING}) {
+        std::cout << "\n1. 300 tasks of 5 ms on ThreadPool(2, " << mode_name(mode) << ", 8), growing past "
+                  << grow_wait_ms << " ms of queue wait..." << std::endl;
+        ThreadPool pool(2, mode, 8, idle_timeout_ms, grow_wait_ms);
+        std::vector<TaskFuture<void>> futures;
+        for (int i = 0; i < 300; ++i) {
+            futures.push_back(pool.submit([]() { std::this_thread::sleep_for(std::chrono::milliseconds(5)); }));
+        }
+        int peak = pool.get_pool_size();
+        for (auto& future : futures) {
+            future.get();
+            peak = std::max(peak, pool.get_pool_size());
+        }
+        std::cout << "   Grew " << pool.get_grow_count() << " times, to " << peak << " workers: "
+                  << (pool.get_grow_count() > 0 && peak > pool.get_min_size() ? "✓ PASS" : "✗ FAIL") << std::endl;
+
+        std::cout << "\n2. Idle past the " << idle_timeout_ms << " ms timeout (" << mode_name(mode) << ")..."
+                  << std::endl;
+        for (int i = 0; i < 100 && pool.get_pool_size() > pool.get_min_size(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(idle_timeout_ms / 4));
+        }
+        bool shrunk = pool.get_pool_size() == pool.get_min_size() && pool.get_shrink_count() > 0;
+        std::cout << "   Back to " << pool.get_pool_size() << " workers: " << (shrunk ? "✓ PASS" : "✗ FAIL")
+                  << std::endl;
+    }
+}
+
+void test_submit_during_shutdown() {
+    print_test_header("Submit Racing Shutdown");
+
+    const int rounds = 30;
+    for (ThreadPoolMode mode : {ThreadPoolMode::SHARED_QUEUE, ThreadPoolMode::WORK_STEALING}) {
+        std::cout << "\n1. " << rounds << " rounds of 4 producers vs shutdown (" << mode_name(mode) << ")..."
+                  << std::endl;
+        int failed = 0;
+        for (int round = 0; round < rounds; ++round) {
+            if (!race_submit_against_shutdown(mode, round)) {
+                failed++;
+            }
+        }
+        std::cout << "   Every accepted task ran, every future ready: "
+                  << (failed == 0 ? "✓ PASS" : "✗ FAIL (" + std::to_string(failed) + " rounds)") << std::endl;
+    }
+}
+
+void test_enqueue_during_destruction() {
+    print_test_header("Worker Enqueues Racing Destruction");
+
+    const int rounds = 30;
+    for (ThreadPoolMode mode : {ThreadPoolMode::SHARED_QUEUE, ThreadPoolMode::WORK_STEALING}) {
+        std::cout << "\n1. " << rounds << " rounds of self-resubmitting tasks vs ~ThreadPool (" << mode_name(mode)
+                  << ")..." << std::endl;
+        int failed = 0;
+        for (int round = 0; round < rounds; ++round) {
+            if (!race_chains_against_destruction(mode)) {
+                failed++;
+            }
+        }
+        std::cout << "   Every accepted task ran: "
+                  << (failed == 0 ? "✓ PASS" : "✗ FAIL (" + std::to_string(failed) + " rounds)") << std::endl;
+    }
+
+    std::cout << "\n2. Enqueue after shutdown..." << std::endl;
+    ThreadPool pool(1);
+    pool.shutdown();
+    bool refused = false;
+    try {
+        pool.enqueue([]() {});
+    } catch (const std::runtime_error&) {
+        refused = true;
+    }
+    std::cout << "   Refused with an exception: " << (refused ? "✓ PASS" : "✗ FAIL") << std::endl;
+}
+
+int main() {
+    std::cout << "\n";
+    print_separator();
+    std::cout << "    THREAD POOL TEST SUITE" << std::endl;
+    std::cout << "    Testing Tasks, Futures, Priorities and Shutdown Ordering" << std::endl;
+    print_separator();
+    std::cout << std::endl;
+
+    try {
+        test_task();
+        std::cout << "\n\n";
+
+        test_futures();
+        std::cout << "\n\n";
+
+        test_work_stealing();
+        std::cout << "\n\n";
+
+        test_submit_bulk();
+        std::cout << "\n\n";
+
+        test_elastic();
+        std::cout << "\n\n";
+
+        test_submit_during_shutdown();
+        std::cout << "\n\n";
+
+        test_enqueue_during_destruction();
+        std::cout << "\n\n";
+
+        print_separator();
+        std::cout << "✓ ALL TESTS COMPLETED SUCCESSFULLY" << std::endl;
+        print_separator();
+        std::cout << std::endl;
+
+    } catch (const std::exception& e) {
+        std::cerr << "\n✗ TEST FAILED WITH EXCEPTION: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "timer_wheel.h"
+#include <algorithm>
+
+TimerWheel::TimerWheel(time_t now) : slots(CACHE_WHEEL_LEVELS * SLOTS, nullptr), current(now), count(0) {}
+
+void TimerWheel::file(CacheEntry* entry, time_t when) {
+    // The lowest level whose span still reaches the deadline
+    uint64_t delta = static_cast<uint64_t>(when - current);
+    int level = 0;
+    while (level + 1 < CACHE_WHEEL_LEVELS && delta >= (uint64_t(1) << (CACHE_WHEEL_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    uint64_t horizon = (uint64_t(1) << (CACHE_WHEEL_SLOT_BITS * CACHE_WHEEL_LEVELS)) - 1;
+    if (delta > horizon) {
+        // Parked as far out as the wheel reaches; re-filed from its real deadline
+        when = current + static_cast<time_t>(horizon);
+    }
+
+    size_t slot = level * SLOTS + ((static_cast<uint64_t>(when) >> (CACHE_WHEEL_SLOT_BITS * level)) & (SLOTS - 1));
+    entry->timer_slot = static_cast<uint16_t>(slot);
+    entry->timer_prev = nullptr;
+    entry->timer_next = slots[slot];
+    if (slots[slot]) {
+        slots[slot]->timer_prev = entry;
+    }
+    slots[slot] = entry;
+}
+
+void TimerWheel::unlink(CacheEntry* entry) {
+    if (entry->timer_prev) {
+        entry->timer_prev->timer_next = entry->timer_next;
+    } else {
+        slots[entry->timer_slot] = entry->timer_next;
+    }
+    if (entry->timer_next) {
+        entry->timer_next->timer_prev = entry->timer_prev;
+    }
+    entry->timer_slot = CacheEntry::TIMER_UNSCHEDULED;
+    entry->timer_prev = nullptr;
+    entry->timer_next = nullptr;
+}
+
+void TimerWheel::cascade(int level) {
+    size_t slot = level * SLOTS + ((static_cast<uint64_t>(current) >> (CACHE_WHEEL_SLOT_BITS * level)) & (SLOTS - 1));
+    CacheEntry* entry = slots[slot];
+    slots[slot] = nullptr;
+
+    // Every deadline in this slot is now less than one of its spans away
+    while (entry) {
+        CacheEntry* next = entry->timer_next;
+        file(entry, std::max(entry->expires_at, current));
+        entry = next;
+    }
+}
+
+void TimerWheel::schedule(CacheEntry* entry) {
+    // The slot for the current second has already been handed out
+    file(entry, std::max(entry->expires_at, current + 1));
+    count++;
+}
+
+void TimerWheel::cancel(CacheEntry* entry) {
+    if (entry->timer_slot != CacheEntry::TIMER_UNSCHEDULED) {
+        unlink(entry);
+        count--;
+    }
+}
+
+void TimerWheel::advance(time_t now, std::vector<CacheEntry*>& expired) {
+    while (current < now) {
+        if (count == 0) {
+            // Nothing to hand out on the way
+            current = now;
+            return;
+        }
+        current++;
+
+        // Where lower levels wrap, pull the next slot of the level above
+        // down, highest first so entries can fall through several levels
+        int top = 0;
+        while (top + 1 < CACHE_WHEEL_LEVELS &&
+               (static_cast<uint64_t>(current) & ((uint64_t(1) << (CACHE_WHEEL_SLOT_BITS * (top + 1))) - 1)) == 0) {
+            top++;
+        }
+        for (int level = top; level >= 1; --level) {
+            cascade(level);
+        }
+
+        size_t slot = static_cast<uint64_t>(current) & (SLOTS - 1);
+        while (CacheEntry* entry = slots[slot]) {
+            unlink(entry);
+            count--;
+            expired.push_back(entry);
+        }
+    }
+}
+
+void TimerWheel::clear() {
+    std::fill(slots.begin(), slots.end(), nullptr);
+    count = 0;
+}
@@ -0,0 +1,51 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include "common.h"
+#include <vector>
+
+/**
+ * Hierarchical timing wheel over CacheEntry::expires_at
+ * Level 0 has one slot per second; each level above covers 64 times the
+ * span of the one below. An entry is filed by how far away its deadline is
+ * and moves down a level whenever the wheel below wraps, so it is touched at
+ * most once per level before it expires. Scheduling and cancelling are O(1)
+ * and nothing is scanned that is not due. Deadlines beyond the top level wait
+ * in it and are re-filed as it comes round. Not thread-safe; the owner locks.
+ */
+class TimerWheel {
+private:
+    static constexpr size_t SLOTS = size_t(1) << CACHE_WHEEL_SLOT_BITS;
+
+    std::vector<CacheEntry*> slots;  // Level-major list heads
+    time_t current;                  // Every deadline up to here has been handed out
+    size_t count;
+
+    // Private helper methods
+    void file(CacheEntry* entry, time_t when);
+    void unlink(CacheEntry* entry);
+    void cascade(int level);
+
+public:
+    explicit TimerWheel(time_t now);
+
+    // Delete copy constructor and assignment operator
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    // entry->expires_at must be set; a deadline already passed fires on the next advance
+    void schedule(CacheEntry* entry);
+    // No-op for an entry that is not scheduled
+    void cancel(CacheEntry* entry);
+
+    // Move the wheel to now and append the entries that have expired; they
+    // are no longer scheduled
+    void advance(time_t now, std::vector<CacheEntry*>& expired);
+
+    // Forget every entry; the owner frees them
+    void clear();
+
+    size_t size() const { return count; }
+};
+
+#endif
@@ -0,0 +1,545 @@
+#include "uring_loop.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <stdexcept>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+namespace {
+
+// Operation tag stored in the top byte of user_data, the fd in the low 32 bits
+enum : uint64_t {
+    OP_ACCEPT = 1,
+    OP_RECV = 2,
+    OP_POLL_OUT = 3,
+    OP_CANCEL = 4,
+    OP_PROVIDE = 5
+};
+
+uint64_t make_user_data(uint64_t op, int fd) {
+    return (op << 56) | static_cast<uint32_t>(fd);
+}
+
+uint64_t user_data_op(uint64_t user_data) {
+    return user_data >> 56;
+}
+
+int user_data_fd(uint64_t user_data) {
+    return static_cast<int>(static_cast<uint32_t>(user_data));
+}
+
+}  // namespace
+
+UringLoop::UringLoop(int listen_socket, ReactorHandlers loop_handlers)
+    : ring_fd(-1), listen_fd(listen_socket), handlers(std::move(loop_handlers)),
+      sq_ring_ptr(MAP_FAILED), sq_ring_size(0), sq_head(nullptr), sq_tail(nullptr),
+      sq_mask(nullptr), sq_array(nullptr), sq_entries(0), sqe_tail(0),
+      sqes(static_cast<struct io_uring_sqe*>(MAP_FAILED)), sqes_size(0),
+      cq_ring_ptr(MAP_FAILED), cq_ring_size(0), cq_head(nullptr), cq_tail(nullptr),
+      cq_mask(nullptr), cqes(nullptr), buffer_pool(nullptr),
+      accepting(false), stopping(false) {
+    if (!handlers.on_open || !handlers.on_message || !handlers.on_close) {
+        throw std::invalid_argument("Ring handlers must not be empty");
+    }
+
+    try {
+        setup_ring();
+        setup_buffers();
+    } catch (...) {
+        release();
+        throw;
+    }
+
+    std::cout << "[UringLoop] Created io_uring event loop (" << sq_entries << " SQ entries, "
+              << URING_BUFFER_COUNT << " provided buffers)" << std::endl;
+}
+
+UringLoop::~UringLoop() {
+    // Tear the ring down first so the kernel drops any request still
+    // referencing connection buffers before they are freed
+    release();
+    for (auto& [fd, conn] : connections) {
+        close(fd);
+    }
+}
+
+void UringLoop::setup_ring() {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, URING_QUEUE_DEPTH, &params));
+    if (ring_fd < 0) {
+        throw std::runtime_error("io_uring_setup failed: " + std::string(strerror(errno)));
+    }
+
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+        throw std::runtime_error("kernel lacks required io_uring features");
+    }
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (cq_ring_size > sq_ring_size) {
+        sq_ring_size = cq_ring_size;
+    }
+    cq_ring_size = sq_ring_size;
+
+    // SQ and CQ rings share one mapping (IORING_FEAT_SINGLE_MMAP)
+    sq_ring_ptr = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ring_ptr == MAP_FAILED) {
+        throw std::runtime_error("Failed to map io_uring rings");
+    }
+    cq_ring_ptr = sq_ring_ptr;
+
+    char* sq = static_cast<char*>(sq_ring_ptr);
+    sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_entries = params.sq_entries;
+    sqe_tail = *sq_tail;
+
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = static_cast<struct io_uring_sqe*>(mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                                                  MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+    if (sqes == MAP_FAILED) {
+        throw std::runtime_error("Failed to map io_uring SQEs");
+    }
+
+    char* cq = static_cast<char*>(cq_ring_ptr);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+void UringLoop::setup_buffers() {
+    buffer_pool = new char[static_cast<size_t>(URING_BUFFER_COUNT) * URING_BUFFER_SIZE];
+    
+    struct io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = URING_BUFFER_COUNT;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer_pool);
+    sqe->len = URING_BUFFER_SIZE;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->off = 0;
+    sqe->user_data = make_user_data(OP_PROVIDE, 0);
+    
+    int ret = submit(1, EPOLL_TIMEOUT_MS);
+    unsigned head = *cq_head;
+    if (ret < 0 || head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+        throw std::runtime_error("Failed to submit provided buffers");
+    }
+    int res = cqes[head & *cq_mask].res;
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+    if (res < 0) {
+        throw std::runtime_error("Failed to provide receive buffers: " + std::string(strerror(-res)));
+    }
+}
+
+void UringLoop::release() {
+    if (ring_fd >= 0) {
+        close(ring_fd);
+        ring_fd = -1;
+    }
+    if (sqes != MAP_FAILED) {
+        munmap(sqes, sqes_size);
+        sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+    }
+    if (sq_ring_ptr != MAP_FAILED) {
+        munmap(sq_ring_ptr, sq_ring_size);
+        sq_ring_ptr = MAP_FAILED;
+        cq_ring_ptr = MAP_FAILED;
+    }
+    delete[] buffer_pool;
+    buffer_pool = nullptr;
+}
+
+void UringLoop::recycle_buffer(unsigned short buffer_id) {
+    // Rides along with the next batch; SQEs run in order, so a recv armed
+    // later in the same batch already sees the buffer
+    struct io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = 1;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer_pool + static_cast<size_t>(buffer_id) * URING_BUFFER_SIZE);
+    sqe->len = URING_BUFFER_SIZE;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->off = buffer_id;
+    sqe->user_data = make_user_data(OP_PROVIDE, 0);
+}
+
+struct io_uring_sqe* UringLoop::get_sqe() {
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (sqe_tail - head >= sq_entries) {
+        // Queue full: flush what we have so the kernel frees slots
+        submit(0, 0);
+        head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+        if (sqe_tail - head >= sq_entries) {
+            throw std::runtime_error("io_uring submission queue is full");
+        }
+    }
+
+    unsigned index = sqe_tail & *sq_mask;
+    struct io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array[index] = index;
+    sqe_tail++;
+    return sqe;
+}
+
+int UringLoop::submit(unsigned wait_nr, int timeout_ms) {
+    __atomic_store_n(sq_tail, sqe_tail, __ATOMIC_RELEASE);
+    unsigned to_submit = sqe_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+
+    unsigned flags = 0;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (wait_nr > 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    }
+
+    int ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, wait_nr, flags,
+                                       wait_nr > 0 ? &arg : nullptr, wait_nr > 0 ? sizeof(arg) : 0));
+    return ret < 0 ? -errno : ret;
+}
+
+void UringLoop::arm_accept() {
+    struct io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = make_user_data(OP_ACCEPT, listen_fd);
+    accepting = true;
+}
+
+void UringLoop::arm_recv(UringConnection& conn) {
+    struct io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn.socket_fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = make_user_data(OP_RECV, conn.socket_fd);
+    conn.inflight_ops++;
+}
+
+void UringLoop::arm_poll_out(UringConnection& conn) {
+    if (conn.poll_armed || conn.closing) {
+        return;
+    }
+
+    struct io_uring_sqe* sqe = get_sqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = conn.socket_fd;
+    sqe->poll32_events = POLLOUT;
+    sqe->user_data = make_user_data(OP_POLL_OUT, conn.socket_fd);
+    conn.poll_armed = true;
+    conn.inflight_ops++;
+}
+
+void UringLoop::write_pending(UringConnection& conn) {
+    if (conn.closing || !conn.outbound) {
+        return;
+    }
+
+    // Frames are written directly with one gathered sendmsg per batch. A send
+    // SQE would complete behind every CQE already in the ring, stalling the
+    // queue during a burst, so the ring only reports when a full socket drains.
+    FlushResult result = conn.outbound->flush();
+    if (result == FlushResult::PENDING) {
+        arm_poll_out(conn);
+    } else if (result == FlushResult::FAILED) {
+        begin_close(conn);
+    }
+}
+
+void UringLoop::flush(const std::shared_ptr<OutboundQueue>& queue) {
+    auto it = connections.find(queue->get_fd());
+    if (it == connections.end() || it->second->closing) {
+        return;
+    }
+
+    // Deferred to the end of the current completion chunk so frames from
+    // several broadcasts leave in one sendmsg, unless a full batch is ready
+    UringConnection& conn = *it->second;
+    conn.outbound = queue;
+    if (!conn.poll_armed && queue->depth() >= OUTBOUND_IOV_MAX / 2) {
+        write_pending(conn);
+        return;
+    }
+    if (!conn.flush_pending) {
+        conn.flush_pending = true;
+        dirty.push_back(conn.socket_fd);
+    }
+}
+
+void UringLoop::flush_dirty() {
+    // Closing a connection broadcasts a leave, which can mark more connections dirty
+    while (!dirty.empty()) {
+        std::vector<int> batch;
+        batch.swap(dirty);
+        for (int fd : batch) {
+            auto it = connections.find(fd);
+            if (it == connections.end()) {
+                continue;
+            }
+            it->second->flush_pending = false;
+            write_pending(*it->second);
+            finish_if_drained(fd);
+        }
+    }
+}
+
+void UringLoop::run(const std::atomic<bool>& running) {
+    while (running.load()) {
+        if (!accepting) {
+            arm_accept();
+        }
+
+        // Every SQE queued while handling the previous batch goes out here
+        int ret = submit(1, EPOLL_TIMEOUT_MS);
+        if (ret < 0 && ret != -ETIME && ret != -EINTR && ret != -EBUSY) {
+            std::cerr << "[UringLoop] io_uring_enter failed: " << strerror(-ret) << std::endl;
+            break;
+        }
+
+        process_completions();
+    }
+
+    stopping = true;
+    if (accepting) {
+        struct io_uring_sqe* sqe = get_sqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = make_user_data(OP_ACCEPT, listen_fd);
+        sqe->user_data = make_user_data(OP_CANCEL, listen_fd);
+    }
+
+    std::vector<int> open_fds;
+    for (auto& [fd, conn] : connections) {
+        open_fds.push_back(fd);
+    }
+    for (int fd : open_fds) {
+        auto it = connections.find(fd);
+        if (it != connections.end()) {
+            begin_close(*it->second);
+            finish_if_drained(fd);
+        }
+    }
+
+    // Reap outstanding completions so buffers are released cleanly
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(EPOLL_TIMEOUT_MS);
+    while (!connections.empty() && std::chrono::steady_clock::now() < deadline) {
+        submit(1, 100);
+        process_completions();
+    }
+
+    std::cout << "[UringLoop] Event loop stopped" << std::endl;
+}
+
+void UringLoop::process_completions() {
+    unsigned head = *cq_head;
+
+    while (true) {
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            break;
+        }
+
+        unsigned reaped = 0;
+        while (head != tail && reaped < URING_COMPLETION_BATCH) {
+            struct io_uring_cqe cqe = cqes[head & *cq_mask];
+            head++;
+            reaped++;
+
+            uint64_t op = user_data_op(cqe.user_data);
+            if (op == OP_ACCEPT) {
+                handle_accept(cqe);
+                continue;
+            }
+            if (op == OP_PROVIDE && cqe.res < 0) {
+                std::cerr << "[UringLoop] Failed to recycle buffer: " << strerror(-cqe.res) << std::endl;
+                continue;
+            }
+            if (op != OP_RECV && op != OP_POLL_OUT) {
+                continue;
+            }
+
+            int fd = user_data_fd(cqe.user_data);
+            auto it = connections.find(fd);
+            if (it == connections.end()) {
+                if (cqe.flags & IORING_CQE_F_BUFFER) {
+                    recycle_buffer(static_cast<unsigned short>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+                }
+                continue;
+            }
+
+            try {
+                if (op == OP_RECV) {
+                    handle_recv(*it->second, cqe);
+                } else {
+                    handle_writable(*it->second, cqe);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "[UringLoop] Exception handling fd " << fd << ": " << e.what() << std::endl;
+                begin_close(*it->second);
+            }
+            finish_if_drained(fd);
+        }
+
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+        // Write out what this chunk queued before reaping more input, so
+        // client queues drain while a burst is still arriving
+        flush_dirty();
+    }
+}
+
+void UringLoop::handle_accept(const struct io_uring_cqe& cqe) {
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        accepting = false;
+    }
+
+    if (cqe.res < 0) {
+        if (cqe.res != -ECANCELED) {
+            std::cerr << "[UringLoop] Accept failed: " << strerror(-cqe.res) << std::endl;
+        }
+        return;
+    }
+
+    int client_socket = cqe.res;
+    if (stopping) {
+        close(client_socket);
+        return;
+    }
+
+    if (handlers.on_accept) {
+        struct sockaddr_in client_addr;
+        socklen_t client_len = sizeof(client_addr);
+        char client_ip[INET_ADDRSTRLEN] = "unknown";
+        if (getpeername(client_socket, (struct sockaddr*)&client_addr, &client_len) == 0) {
+            inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
+        }
+        handlers.on_accept(client_socket, client_ip);
+    }
+
+    auto conn = std::make_unique<UringConnection>(client_socket);
+    UringConnection& ref = *conn;
+    connections[client_socket] = std::move(conn);
+    arm_recv(ref);
+}
+
+void UringLoop::handle_recv(UringConnection& conn, const struct io_uring_cqe& cqe) {
+    bool more = cqe.flags & IORING_CQE_F_MORE;
+    if (!more) {
+        conn.inflight_ops--;
+    }
+
+    if (cqe.flags & IORING_CQE_F_BUFFER) {
+        unsigned short buffer_id = static_cast<unsigned short>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (cqe.res > 0 && !conn.closing) {
+            // Kernels that do not report a non-empty socket leave input_idle set
+            consume_input(conn, buffer_pool + static_cast<size_t>(buffer_id) * URING_BUFFER_SIZE,
+                          static_cast<size_t>(cqe.res), !(cqe.flags & IORING_CQE_F_SOCK_NONEMPTY));
+        }
+        recycle_buffer(buffer_id);
+    }
+
+    if (conn.closing) {
+        return;
+    }
+
+    if (cqe.res == -ENOBUFS) {
+        // Provided buffers ran dry; consumed ones are being handed back, so just re-arm
+        arm_recv(conn);
+    } else if (cqe.res <= 0) {
+        begin_close(conn);
+    } else if (!more) {
+        arm_recv(conn);
+    }
+}
+
+void UringLoop::handle_writable(UringConnection& conn, const struct io_uring_cqe& cqe) {
+    conn.inflight_ops--;
+    conn.poll_armed = false;
+
+    if (conn.closing) {
+        return;
+    }
+    if (cqe.res < 0 || (cqe.res & (POLLERR | POLLHUP))) {
+        begin_close(conn);
+        return;
+    }
+    write_pending(conn);
+}
+
+void UringLoop::consume_input(UringConnection& conn, const char* data, size_t length, bool input_idle) {
+    if (!conn.reader.append(data, length)) {
+        begin_close(conn);
+        return;
+    }
+
+    // The user ID and protocol hello come through the ring too: they may be
+    // split across completions or share one with the first frames
+    if (!conn.registered) {
+        std::string user_id;
+        uint8_t version;
+        DecodeStatus hello_status = conn.reader.hello(user_id, version, input_idle);
+        if (hello_status == DecodeStatus::INCOMPLETE) {
+            return;
+        }
+        if (hello_status == DecodeStatus::INVALID || !handlers.on_open(conn.socket_fd, user_id, version)) {
+            begin_close(conn);
+            return;
+        }
+        conn.user_id = user_id;
+        conn.registered = true;
+    }
+
+    Message msg;
+    DecodeStatus status = DecodeStatus::INCOMPLETE;
+    while (!conn.closing && (status = conn.reader.next(msg)) == DecodeStatus::COMPLETE) {
+        handlers.on_message(conn.socket_fd, conn.user_id, msg);
+    }
+    if (!conn.closing && status == DecodeStatus::INVALID) {
+        begin_close(conn);
+    }
+}
+
+void UringLoop::begin_close(UringConnection& conn) {
+    if (conn.closing) {
+        return;
+    }
+    conn.closing = true;
+
+    // Shutdown ends the multishot recv and completes a pending write poll; the
+    // fd itself stays open until every request on it has completed
+    shutdown(conn.socket_fd, SHUT_RDWR);
+
+    // on_close closes the outbound queue, dropping anything still queued
+    if (conn.registered) {
+        handlers.on_close(conn.socket_fd, conn.user_id);
+    }
+}
+
+void UringLoop::finish_if_drained(int socket_fd) {
+    auto it = connections.find(socket_fd);
+    if (it == connections.end()) {
+        return;
+    }
+    if (it->second->closing && it->second->inflight_ops == 0) {
+        close(socket_fd);
+        connections.erase(it);
+    }
+}
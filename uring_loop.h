@@ -0,0 +1,114 @@
+#ifndef URING_LOOP_H
+#define URING_LOOP_H
+
+#include "common.h"
+#include "reactor.h"
+#include "protocol.h"
+#include "frame_reader.h"
+#include "outbound_queue.h"
+#include <linux/io_uring.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+
+// Per-connection state owned by the ring thread
+struct UringConnection {
+    int socket_fd;
+    std::string user_id;
+    bool registered;
+    bool closing;
+    bool poll_armed;     // Waiting for a full socket to become writable
+    bool flush_pending;  // Listed in UringLoop::dirty
+    int inflight_ops;    // SQEs whose final completion has not been reaped yet
+    FrameReader reader;  // Reassembles messages across partial and coalesced reads
+    std::shared_ptr<OutboundQueue> outbound;  // Attached on the first flush
+
+    explicit UringConnection(int fd)
+        : socket_fd(fd), registered(false), closing(false),
+          poll_armed(false), flush_pending(false), inflight_ops(0) {}
+};
+
+/**
+ * io_uring event loop built on raw syscalls (no liburing)
+ * Uses multishot accept, multishot recv from a provided-buffer group, and
+ * drains each client's OutboundQueue once per chunk of completions, with a
+ * POLLOUT request (submitted in one io_uring_enter per loop iteration) while
+ * a socket is full. All handlers run on the ring thread, so flush must only
+ * be called from inside a handler.
+ */
+class UringLoop {
+private:
+    int ring_fd;
+    int listen_fd;
+    ReactorHandlers handlers;
+
+    // Submission queue
+    void* sq_ring_ptr;
+    size_t sq_ring_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned sq_entries;
+    unsigned sqe_tail;  // Local tail, published on submit
+    struct io_uring_sqe* sqes;
+    size_t sqes_size;
+
+    // Completion queue
+    void* cq_ring_ptr;
+    size_t cq_ring_size;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+
+    // Provided receive buffers, handed back to the kernel as they are consumed
+    char* buffer_pool;
+
+    std::unordered_map<int, std::unique_ptr<UringConnection>> connections;
+    std::vector<int> dirty;  // Connections with frames queued since the last flush
+    bool accepting;
+    bool stopping;
+
+    // Private helper methods
+    void setup_ring();
+    void setup_buffers();
+    void release();
+    struct io_uring_sqe* get_sqe();
+    int submit(unsigned wait_nr, int timeout_ms);
+    void recycle_buffer(unsigned short buffer_id);
+
+    void arm_accept();
+    void arm_recv(UringConnection& conn);
+    void arm_poll_out(UringConnection& conn);
+    void write_pending(UringConnection& conn);
+    void flush_dirty();
+
+    void process_completions();
+    void handle_accept(const struct io_uring_cqe& cqe);
+    void handle_recv(UringConnection& conn, const struct io_uring_cqe& cqe);
+    void handle_writable(UringConnection& conn, const struct io_uring_cqe& cqe);
+    void consume_input(UringConnection& conn, const char* data, size_t length, bool input_idle);
+    void begin_close(UringConnection& conn);
+    void finish_if_drained(int socket_fd);
+
+public:
+    UringLoop(int listen_socket, ReactorHandlers loop_handlers);
+    ~UringLoop();
+
+    // Delete copy constructor and assignment operator
+    UringLoop(const UringLoop&) = delete;
+    UringLoop& operator=(const UringLoop&) = delete;
+
+    // Run the event loop until running becomes false, then close all connections
+    void run(const std::atomic<bool>& running);
+
+    // Start draining a client's queue; the SQE goes out with the next batch
+    void flush(const std::shared_ptr<OutboundQueue>& queue);
+
+    size_t get_connection_count() const { return connections.size(); }
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef WORK_DEQUE_H
+#define WORK_DEQUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Chase-Lev work-stealing deque of T pointers (Le, Pop, Cohen & Zappa
+ * Nardelli's C11 formulation)
+ * The owning thread pushes and takes at the bottom, with a CAS only when it
+ * races a thief for the last item; any other thread steals from the top
+ * with one CAS. The ring doubles when full. Replaced rings are kept until
+ * the deque is destroyed, because a thief may still be reading one. The
+ * deque does not own the items.
+ */
+template <typename T>
+class WorkDeque {
+private:
+    struct Ring {
+        int64_t capacity;  // Power of two
+        std::unique_ptr<std::atomic<T*>[]> slots;
+
+        explicit Ring(int64_t cap) : capacity(cap), slots(new std::atomic<T*>[cap]) {}
+
+        std::atomic<T*>& at(int64_t i) { return slots[i & (capacity - 1)]; }
+    };
+
+    // Thieves hammer top, the owner bottom; keep them on separate lines
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+    std::atomic<Ring*> ring;
+    std::vector<std::unique_ptr<Ring>> rings;  // Every ring ever used, current last; owner only
+
+    // Private helper methods
+    Ring* grow(Ring* old, int64_t t, int64_t b) {
+        rings.push_back(std::make_unique<Ring>(old->capacity * 2));
+        Ring* bigger = rings.back().get();
+        for (int64_t i = t; i < b; ++i) {
+            bigger->at(i).store(old->at(i).load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        ring.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+public:
+    // capacity must be a power of two
+    explicit WorkDeque(int64_t capacity = 256) : top(0), bottom(0) {
+        rings.push_back(std::make_unique<Ring>(capacity));
+        ring.store(rings.back().get(), std::memory_order_relaxed);
+    }
+
+    // Delete copy constructor and assignment operator
+    WorkDeque(const WorkDeque&) = delete;
+    WorkDeque& operator=(const WorkDeque&) = delete;
+
+    // Owner only
+    void push(T* item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Ring* current = ring.load(std::memory_order_relaxed);
+        if (b - t > current->capacity - 1) {
+            current = grow(current, t, b);
+        }
+        current->at(b).store(item, std::memory_order_relaxed);
+        // Release publishes the item to the thief that claims it
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // Owner only: the most recently pushed item, nullptr if empty
+    T* take() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring* current = ring.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* item = current->at(b).load(std::memory_order_relaxed);
+        if (t == b) {
+            // The last item: whoever moves top first gets it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Any thread: the oldest item, nullptr if empty or another thread got it first
+    T* steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        T* item = ring.load(std::memory_order_acquire)->at(t).load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    // Approximate unless called by the owner with no thieves about
+    size_t size() const {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+    bool empty() const { return size() == 0; }
+};
+
+#endif